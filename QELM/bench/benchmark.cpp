@@ -0,0 +1,314 @@
+//
+//  benchmark.cpp
+//  QELM
+//
+//  Benchmark harness: generated random functions and MCNC-style arithmetic
+//  PLAs (or PLA files given on the command line), run per engine and thread
+//  count. Every run is forked so its peak RSS is its own.
+//
+
+#include <stdio.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "term.hpp"
+#include "quine.hpp"
+#include "espresso.hpp"
+#include "bdd.hpp"
+#include "pla.hpp"
+#include "arena.hpp"
+#include "cube_batch.hpp"
+#include "minimizer.hpp"
+#include "utils.hpp"
+
+using namespace std;
+
+struct Workload {
+    string name;
+    PLAFile pla;
+};
+
+// Metrics of one run, passed from the child back to the parent
+struct RunStats {
+    double ms = 0;
+    long peakRssKb = 0;
+    size_t arenaPeakBytes = 0;
+    int rounds = 0;             // QM only
+    size_t primes = 0;          // QM only
+    size_t cubes = 0;
+    int literals = 0;
+    bool ok = false;
+};
+
+// === Generators ===
+
+// Random function over numVars inputs: each minterm is on with probability
+// onDensity, else don't care with probability dcDensity
+static Workload randomWorkload(int numVars, int numOutputs, double onDensity, double dcDensity, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_real_distribution<double> coin(0, 1);
+    Workload w;
+    char name[64];
+    snprintf(name, sizeof(name), "rand%d_%d_on%02d_dc%02d", numVars, numOutputs,
+             static_cast<int>(onDensity * 100), static_cast<int>(dcDensity * 100));
+    w.name = name;
+    w.pla.numVars = numVars;
+    w.pla.numOutputs = numOutputs;
+    for (int m = 0; m < (1 << numVars); m++) {
+        OutputMask on, dc;
+        for (int k = 0; k < numOutputs; k++) {
+            double r = coin(rng);
+            if (r < onDensity) on.set(k);
+            else if (r < onDensity + dcDensity) dc.set(k);
+        }
+        Term row(m, numVars);
+        if (on.any()) w.pla.onRows.push_back(PLACube(row, on));
+        if (dc.any()) w.pla.dcRows.push_back(PLACube(row, dc));
+    }
+    return w;
+}
+
+// Random cover of wide cubes: for functions too large to list by minterm
+static Workload randomCoverWorkload(int numVars, int numCubes, double literalDensity, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_real_distribution<double> coin(0, 1);
+    Workload w;
+    w.name = "cover" + to_string(numVars) + "_" + to_string(numCubes);
+    w.pla.numVars = numVars;
+    OutputMask out;
+    out.set(0);
+    for (int i = 0; i < numCubes; i++) {
+        Cube c;
+        for (int j = 0; j < numVars; j++) {
+            if (coin(rng) < literalDensity) c.setLiteral(j, rng() % 2 ? '1' : '0');
+        }
+        w.pla.onRows.push_back(PLACube(Term(c, numVars), out));
+    }
+    return w;
+}
+
+// Completely specified multi-output function given as a truth table
+static Workload arithmeticWorkload(const string& name, int numVars, int numOutputs, function<uint64_t(uint64_t)> f) {
+    Workload w;
+    w.name = name;
+    w.pla.numVars = numVars;
+    w.pla.numOutputs = numOutputs;
+    for (uint64_t m = 0; m < (uint64_t(1) << numVars); m++) {
+        uint64_t y = f(m);
+        OutputMask on;
+        for (int k = 0; k < numOutputs; k++) {
+            // Output 0 is the most significant bit, as in the MCNC files
+            if ((y >> (numOutputs - 1 - k)) & 1) on.set(k);
+        }
+        if (on.any()) w.pla.onRows.push_back(PLACube(Term(static_cast<int>(m), numVars), on));
+    }
+    return w;
+}
+
+// Functions with the same truth tables as the MCNC rd53/rd73/rd84, sqrt8,
+// squar5 and z4ml benchmarks
+static vector<Workload> mcncWorkloads() {
+    auto popcount = [](uint64_t m) { return static_cast<uint64_t>(__builtin_popcountll(m)); };
+    vector<Workload> w;
+    w.push_back(arithmeticWorkload("rd53", 5, 3, popcount));
+    w.push_back(arithmeticWorkload("rd73", 7, 3, popcount));
+    w.push_back(arithmeticWorkload("rd84", 8, 4, popcount));
+    w.push_back(arithmeticWorkload("sqrt8", 8, 4, [](uint64_t m) {
+        uint64_t r = 0;
+        while ((r + 1) * (r + 1) <= m) r++;
+        return r;
+    }));
+    w.push_back(arithmeticWorkload("squar5", 5, 8, [](uint64_t m) { return (m * m) >> 2; }));
+    w.push_back(arithmeticWorkload("z4ml", 7, 4, [](uint64_t m) {
+        // carry in, then two 3-bit operands
+        return ((m >> 6) & 1) + ((m >> 3) & 7) + (m & 7);
+    }));
+    return w;
+}
+
+// === Runs ===
+
+static RunStats runOnce(const Workload& w, Engine engine, int numThreads, int passes) {
+    RunStats stats;
+    // Hook calls come from worker threads too
+    atomic<size_t> arenaPeak(0);
+    setArenaStatsHook([&arenaPeak](const ArenaStats& s) {
+        size_t seen = arenaPeak.load();
+        while (s.peakBytes > seen && !arenaPeak.compare_exchange_weak(seen, s.peakBytes)) {}
+    });
+
+    vector<vector<Term>> on = splitByOutput(w.pla.onRows, w.pla.numOutputs);
+    vector<vector<Term>> dc = splitByOutput(w.pla.dcRows, w.pla.numOutputs);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<Term> all;
+    for (int k = 0; k < w.pla.numOutputs; k++) {
+        vector<Term> cover;
+        if (engine == Engine::Quine) {
+            QuineStats q;
+            cover = runQuine(on[k], dc[k], numThreads, CoverOptions(), nullptr, &q);
+            stats.rounds += q.rounds;
+            stats.primes += q.primes;
+        } else if (engine == Engine::Espresso) {
+            EspressoOptions options;
+            options.passes = passes;
+            options.numThreads = numThreads;
+            cover = runEspressoMultiple(on[k], dc[k], w.pla.numVars, options);
+        } else if (engine == Engine::Bdd) {
+            cover = runBddMinimize(on[k], dc[k], w.pla.numVars);
+        } else {
+            MinimizerOptions options;
+            options.passes = passes;
+            options.numThreads = numThreads;
+            cover = Minimizer(options).minimizeFunction(on[k], dc[k], w.pla.numVars).cover;
+        }
+        all.insert(all.end(), cover.begin(), cover.end());
+    }
+    stats.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    setArenaStatsHook(nullptr);
+    stats.arenaPeakBytes = arenaPeak;
+    stats.cubes = all.size();
+    stats.literals = countLiterals(all);
+    stats.ok = true;
+    return stats;
+}
+
+// Runs in a child process so peak RSS and crashes stay per run
+static RunStats runForked(const Workload& w, Engine engine, int numThreads, int passes) {
+    RunStats stats;
+    int fds[2];
+    if (pipe(fds) != 0) return stats;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        RunStats child;
+        try {
+            child = runOnce(w, engine, numThreads, passes);
+        } catch (const exception&) {
+            child.ok = false;
+        }
+        ssize_t written = write(fds[1], &child, sizeof(child));
+        _exit(written == static_cast<ssize_t>(sizeof(child)) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t got = read(fds[0], &stats, sizeof(stats));
+    close(fds[0]);
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    if (got != static_cast<ssize_t>(sizeof(stats))) stats.ok = false;
+    stats.peakRssKb = usage.ru_maxrss;
+    return stats;
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--engine auto|quine|espresso|bdd|all] [--threads 1,2,4] [--passes N]\n"
+            "          [--kernel scalar|avx2|avx512] [--quick] [file.pla ...]\n"
+            "Without PLA files the generated workloads are used.\n",
+            program);
+}
+
+int main(int argc, char* argv[]) {
+    vector<Engine> engines = {Engine::Quine, Engine::Espresso, Engine::Bdd};
+    vector<int> threads = {1, 4};
+    int passes = 3;
+    bool quick = false;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--kernel" && i + 1 < argc) {
+            string value = argv[++i];
+            bool known = false;
+            for (CubeKernel k : {CubeKernel::Scalar, CubeKernel::Avx2, CubeKernel::Avx512}) {
+                if (value != cubeKernelName(k)) continue;
+                known = true;
+                if (!setCubeKernel(k)) {
+                    fprintf(stderr, "This CPU does not support the %s kernel\n", value.c_str());
+                    return 1;
+                }
+            }
+            if (!known) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if ((arg == "--engine" || arg == "--threads" || arg == "--passes") && i + 1 < argc) {
+            string value = argv[++i];
+            if (arg == "--engine") {
+                Engine e;
+                if (value == "all") engines = {Engine::Quine, Engine::Espresso, Engine::Bdd, Engine::Auto};
+                else if (parseEngine(value, e)) engines = {e};
+                else {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (arg == "--threads") {
+                threads.clear();
+                for (char* tok = strtok(&value[0], ","); tok; tok = strtok(nullptr, ",")) threads.push_back(atoi(tok));
+            } else {
+                passes = atoi(value.c_str());
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    vector<Workload> workloads;
+    if (!files.empty()) {
+        for (const string& file : files) {
+            Workload w;
+            w.name = file.substr(file.find_last_of('/') + 1);
+            if (!parsePLA(file, w.pla)) return 1;
+            workloads.push_back(w);
+        }
+    } else {
+        workloads = mcncWorkloads();
+        workloads.push_back(randomWorkload(8, 4, 0.4, 0.1, 1));
+        workloads.push_back(randomWorkload(10, 2, 0.3, 0.3, 2));
+        if (!quick) {
+            workloads.push_back(randomWorkload(12, 4, 0.3, 0.1, 3));
+            workloads.push_back(randomWorkload(14, 1, 0.5, 0.0, 4));
+            workloads.push_back(randomCoverWorkload(20, 200, 0.4, 5));
+        }
+    }
+
+    printf("# cube kernel: %s\n", cubeKernelName(cubeKernel()));
+    printf("%-22s %-9s %3s %10s %9s %10s %6s %7s %6s %8s\n",
+           "workload", "engine", "thr", "ms", "rss_kb", "arena_kb", "rounds", "primes", "cubes", "literals");
+    for (const Workload& w : workloads) {
+        for (Engine engine : engines) {
+            // QM enumerates minterms: skip it where that cannot work
+            if (engine == Engine::Quine && w.pla.numVars > 16) continue;
+            for (int t : threads) {
+                RunStats s = runForked(w, engine, t, passes);
+                if (!s.ok) {
+                    printf("%-22s %-9s %3d %10s\n", w.name.c_str(), engineName(engine), t, "failed");
+                    continue;
+                }
+                printf("%-22s %-9s %3d %10.2f %9ld %10zu %6d %7zu %6zu %8d\n",
+                       w.name.c_str(), engineName(engine), t, s.ms, s.peakRssKb, s.arenaPeakBytes / 1024,
+                       s.rounds, s.primes, s.cubes, s.literals);
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef arena_hpp
+#define arena_hpp
+
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+
+// Per-run scratch memory. Blocks come from the heap in large chunks, freed
+// blocks are reused through size-class pools, and everything goes back to the
+// heap at once when the run ends.
+
+struct ArenaStats {
+    const char* run = "";       // label given to the ArenaScope
+    size_t peakBytes = 0;       // most heap memory the arena held at once
+    size_t chunks = 0;          // heap allocations made for it
+    size_t reusedChunks = 0;    // chunks taken from the thread's chunk cache instead
+};
+
+class Arena : public std::pmr::memory_resource {
+public:
+    explicit Arena(const char* run);
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    const ArenaStats& stats() const { return upstream.stats; }
+
+private:
+    // Heap blocks handed to the pools, counted for the stats
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        ArenaStats stats;
+        size_t bytes = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    CountingResource upstream;
+    std::pmr::unsynchronized_pool_resource pools;
+};
+
+// Makes a fresh arena the scratch resource of this thread until the scope ends.
+// Scopes nest; scratch containers must not outlive the scope they were made in.
+class ArenaScope {
+public:
+    explicit ArenaScope(const char* run);
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena arena;
+    std::pmr::memory_resource* previous;
+};
+
+// Arena of the innermost ArenaScope on this thread, or the plain heap outside one
+std::pmr::memory_resource* scratchResource();
+
+// Lets the arenas of the calling thread keep up to maxBytes of the chunks they
+// release for the next arena on the thread, instead of handing them back to
+// the heap (0, the default, keeps none). Worth it on threads that run many
+// small minimizations in a row, which otherwise fault in fresh pages for each.
+// The chunks kept go back to the heap when the thread exits.
+void setArenaChunkCache(size_t maxBytes);
+
+// Called with the stats of every arena as it is released (from the thread that
+// owned it). Pass an empty function to turn reporting off.
+void setArenaStatsHook(std::function<void(const ArenaStats&)> hook);
+
+#endif /* arena_hpp */
@@ -0,0 +1,57 @@
+#ifndef batch_hpp
+#define batch_hpp
+
+#include <string>
+#include <vector>
+
+#include "minimizer.hpp"
+
+// Batch mode: many PLA files minimized in one process on one work-stealing
+// pool. Each file is a task that parses it and queues a task per output (see
+// Minimizer::minimizeAsync); whichever task finishes a file's last output
+// writes its result. Small files fill the gaps left by big ones, and no worker
+// ever waits for a file to finish.
+
+struct BatchOptions {
+    MinimizerOptions minimizer;     // numThreads sizes the pool; every task runs single-threaded
+    std::string outputDirectory;    // one output per input, named after it; created if missing
+    std::string format = "report";  // report, pla or binary, as in writeResult
+};
+
+struct BatchFileResult {
+    std::string input;
+    std::string output;             // empty when nothing was written
+    std::string error;              // empty on success
+    int numVars = 0;
+    int numOutputs = 0;
+    size_t productTerms = 0;        // distinct product terms over all outputs
+    size_t literals = 0;            // literals of the output covers, summed
+    bool cancelled = false;         // the deadline cut at least one output short
+    double parseSeconds = 0;
+    double engineSeconds = 0;       // MinimizeResult::engineSeconds
+    double writeSeconds = 0;
+};
+
+struct BatchSummary {
+    std::vector<BatchFileResult> files;     // in input order
+    int threads = 0;
+    int failed = 0;
+    double wallSeconds = 0;
+};
+
+// Expands batch inputs: a directory stands for the .pla files in it (sorted),
+// @FILE for the paths listed in FILE one per line, anything else for itself.
+// Prints the reason to cerr and returns false when one cannot be read.
+bool collectBatchInputs(const std::vector<std::string>& args, std::vector<std::string>& files);
+
+// Minimizes and writes every file. A file that fails to parse, minimize or
+// write is recorded as failed and the others go on. Output names are the
+// input stem plus .txt, .pla or .qcb by format, with -2, -3, ... added to
+// stems already taken; an output that would replace its own input is refused.
+BatchSummary runBatch(const std::vector<std::string>& files, const BatchOptions& options);
+
+// Tab-separated summary: the totals as # comments, then a header line and
+// one row per file
+bool writeBatchSummary(const std::string& path, const BatchSummary& summary);
+
+#endif /* batch_hpp */
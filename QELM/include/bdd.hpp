@@ -0,0 +1,85 @@
+#ifndef bdd_hpp
+#define bdd_hpp
+
+#include "cube.hpp"
+#include "term.hpp"
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+// Reduced ordered BDDs over up to Cube::MAX_VARS variables. A node is its index
+// in the node table (0 = false, 1 = true); nodes live as long as the manager.
+// Structurally equal nodes are shared through the unique table, and results of
+// AND / OR / NOT are remembered in a fixed-size computed cache.
+class BddManager {
+public:
+    typedef int Node;
+    static const Node FALSE_NODE = 0;
+    static const Node TRUE_NODE = 1;
+
+    // order[level] is the variable tested at that level (a permutation of 0..numVars-1).
+    // Creating more than nodeLimit nodes throws std::length_error.
+    BddManager(int numVars, const std::vector<int>& order, size_t nodeLimit, size_t cacheSize);
+
+    Node cube(const Cube& c);
+    Node cover(const std::vector<Cube>& F);
+
+    Node bddAnd(Node a, Node b);
+    Node bddOr(Node a, Node b);
+    Node bddNot(Node a);
+    bool implies(Node a, Node b) { return bddAnd(a, bddNot(b)) == FALSE_NODE; }
+
+    // Minato-Morreale irredundant sum of products of some f with lower <= f <= upper
+    std::vector<Cube> isop(Node lower, Node upper);
+
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+    struct NodeData {
+        int level;      // numVars for the two terminals
+        Node lo, hi;
+    };
+    struct CacheEntry {
+        int op = -1;
+        Node a = 0, b = 0, result = 0;
+    };
+    struct IsopResult {
+        Node f;
+        std::vector<Cube> cubes;
+    };
+
+    Node make(int level, Node lo, Node hi);
+    void growUnique();
+    Node apply(int op, Node a, Node b);
+    Node coverRange(const std::vector<Cube>& F, size_t begin, size_t end);
+    const IsopResult& isopRec(Node lower, Node upper);
+
+    int level(Node n) const { return nodes[n].level; }
+    Node low(Node n, int lv) const { return nodes[n].level == lv ? nodes[n].lo : n; }
+    Node high(Node n, int lv) const { return nodes[n].level == lv ? nodes[n].hi : n; }
+
+    int numVars;
+    std::vector<int> order;
+    size_t nodeLimit;
+
+    std::vector<NodeData> nodes;
+    std::vector<Node> unique;                   // open addressing, -1 = empty
+    std::vector<CacheEntry> cache;
+    std::unordered_map<uint64_t, IsopResult> isopMemo;
+};
+
+struct BddOptions {
+    size_t nodeLimit = size_t(1) << 22;     // past this many nodes runBddMinimize throws std::length_error
+    size_t cacheSize = size_t(1) << 18;     // computed-cache entries, rounded up to a power of two
+};
+
+// Static variable order: variables with the most literals in F are tested first
+std::vector<int> bddVariableOrder(const std::vector<Cube>& F, int numVars);
+
+// Builds BDDs of the on-set and on+dc-set, takes their ISOP, raises every cube
+// to a prime of on+dc and drops redundant cubes. Never enumerates minterms.
+std::vector<Term> runBddMinimize(const std::vector<Term>& onSet, const std::vector<Term>& dcSet, int numVars,
+                                 const BddOptions& options = BddOptions());
+
+#endif /* bdd_hpp */
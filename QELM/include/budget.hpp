@@ -0,0 +1,31 @@
+#ifndef budget_hpp
+#define budget_hpp
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+// Memory budgets of the engines. An engine only checks its large tables (QM
+// term lists and prime chart, the consensus cube list, the Espresso OFF-set,
+// BDD nodes) against the budget it is given, so a run stays within a small
+// factor of the budget rather than to the byte.
+
+// Thrown by an engine whose tables would grow past its budget
+class MemoryBudgetExceeded : public std::runtime_error {
+public:
+    explicit MemoryBudgetExceeded(const std::string& table)
+        : std::runtime_error("memory budget exceeded by " + table) {}
+};
+
+// Throws when count items of itemBytes each do not fit in budgetBytes (0 = no budget)
+inline void checkMemoryBudget(size_t budgetBytes, size_t count, size_t itemBytes, const char* table) {
+    if (budgetBytes > 0 && count > budgetBytes / itemBytes) throw MemoryBudgetExceeded(table);
+}
+
+// Most items of itemBytes each that fit in budgetBytes; 0 (no limit) without a budget
+inline size_t budgetItems(size_t budgetBytes, size_t itemBytes) {
+    if (budgetBytes == 0) return 0;
+    return budgetBytes / itemBytes > 0 ? budgetBytes / itemBytes : 1;
+}
+
+#endif /* budget_hpp */
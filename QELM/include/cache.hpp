@@ -0,0 +1,70 @@
+#ifndef cache_hpp
+#define cache_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "term.hpp"
+
+// Content-addressed on-disk cache of minimized covers. The key is a hash of
+// the sorted, deduplicated on- and dc-set cubes plus a tag for the options
+// that change the result, so the same function is found again whatever its
+// labels or row order.
+
+struct CacheKey {
+    uint64_t high = 0, low = 0;
+
+    std::string hex() const;
+};
+
+// Feeds functions and option tags into a 128-bit key
+class CacheKeyBuilder {
+public:
+    // The cube lists are sorted and deduplicated first
+    void addFunction(const std::vector<Term>& onSet, const std::vector<Term>& dcSet, int numVars);
+    void addTag(const std::string& tag);
+    CacheKey key() const { return current; }
+
+private:
+    void addWord(uint64_t word);
+
+    CacheKey current;
+};
+
+// One cached cover; engine and flags are stored as given and interpreted by the caller
+struct CachedCover {
+    std::vector<Term> cover;
+    uint8_t engine = 0;
+    uint8_t flags = 0;
+};
+
+// Entry files are <key>.qc in one directory: a magic, numVars and the output
+// count, then per output its engine, flags, cube count and the cubes as
+// (value, care) pairs of only the 64-bit words numVars needs, in host byte order.
+// A damaged entry is a miss and is removed. Lookups refresh the file time; stores evict the least recently used entries
+// until the directory fits in maxBytes. Safe to share between threads and
+// processes: entries are written to a temporary file and renamed into place.
+class ResultCache {
+public:
+    ResultCache(const std::string& directory, uint64_t maxBytes);
+
+    bool lookup(const CacheKey& key, int numVars, std::vector<CachedCover>& outputs) const;
+    void store(const CacheKey& key, int numVars, const std::vector<CachedCover>& outputs);
+
+    const std::string& getDirectory() const { return directory; }
+
+private:
+    void evict();
+
+    std::string directory;
+    uint64_t maxBytes;
+    // Bytes stored since the directory was last measured; it is only measured
+    // again once that could have pushed it past the limit
+    std::atomic<uint64_t> bytesSinceScan{0};
+    std::mutex evictLock;
+};
+
+#endif /* cache_hpp */
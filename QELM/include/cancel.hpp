@@ -0,0 +1,43 @@
+#ifndef cancel_hpp
+#define cancel_hpp
+
+#include <atomic>
+#include <chrono>
+
+// Deadline and cancellation for one job, shared by every engine and thread
+// working on it. Engines poll it between units of work (a combining round, a
+// cube of EXPAND, a node of the cover search) and, once it fires, return the
+// best valid cover they have instead of finishing.
+class CancelToken {
+public:
+    CancelToken() = default;
+    // Fires seconds from now (never for seconds <= 0) or on cancel()
+    explicit CancelToken(double seconds) { setDeadline(seconds); }
+
+    CancelToken(const CancelToken&) = delete;
+    CancelToken& operator=(const CancelToken&) = delete;
+
+    void setDeadline(double seconds) {
+        hasDeadline = seconds > 0;
+        deadline = std::chrono::steady_clock::now() +
+                   std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    // Safe to call from any thread
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+    bool expired() const {
+        if (cancelled.load(std::memory_order_relaxed)) return true;
+        return hasDeadline && std::chrono::steady_clock::now() >= deadline;
+    }
+
+private:
+    std::atomic<bool> cancelled{false};
+    bool hasDeadline = false;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+// Null tokens never fire
+inline bool cancelRequested(const CancelToken* token) { return token && token->expired(); }
+
+#endif /* cancel_hpp */
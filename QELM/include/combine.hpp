@@ -1,6 +1,11 @@
 #pragma once
 #include "term.hpp"
+#include "cancel.hpp"
 #include <vector>
 
-// Declare the combineTerms function here
-std::vector<Term> combineTerms(const std::vector<Term>& terms);
+// One Quine-McCluskey merge round: returns the terms that did not combine
+// followed by every merged term. numThreads workers share the ones-groups
+// (0 = one per hardware thread); the result is the same for any thread count.
+// When cancel fires mid-round the round is dropped and terms come back as they are.
+std::vector<Term> combineTerms(const std::vector<Term>& terms, int numThreads = 1,
+                               const CancelToken* cancel = nullptr);
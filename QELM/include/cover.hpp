@@ -0,0 +1,31 @@
+#ifndef cover_hpp
+#define cover_hpp
+
+#include <vector>
+#include <cstddef>
+
+#include "cancel.hpp"
+
+// Unate covering: pick a minimum-cost set of columns so that every row
+// contains at least one picked column. Used for the cyclic core of the
+// prime implicant chart once essential primes are taken out.
+
+struct CoverOptions {
+    size_t nodeLimit = 100000;      // branch-and-bound nodes before giving up on optimality
+    double timeLimitSeconds = 0;    // 0 = no time limit
+    const CancelToken* cancel = nullptr;    // stops the search like the limits above (null = never)
+};
+
+struct CoverResult {
+    std::vector<int> columns;       // chosen columns, ascending
+    long long cost = 0;
+    bool optimal = true;            // false when a budget ran out and the best cover so far was kept
+    size_t nodes = 0;               // branch-and-bound nodes explored
+};
+
+// rows[r] lists the columns that cover row r; costs[c] is the cost of column c.
+// Rows with no column cannot be covered and are ignored.
+CoverResult solveCover(const std::vector<std::vector<int>>& rows, const std::vector<long long>& costs,
+                       const CoverOptions& options = CoverOptions());
+
+#endif /* cover_hpp */
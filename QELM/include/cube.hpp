@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Packed cube: two bits per variable, split across a value mask and a care mask.
+// Variable j (column j of the binary string) lives in bit (j % 64) of word (j / 64).
+//   care = 0            -> '-'
+//   care = 1, value = 0 -> '0'
+//   care = 1, value = 1 -> '1'
+// Value bits are always kept clear where care is clear, so two cubes are equal
+// exactly when their words are equal. WORDS * 2 * 8 bytes = one 64 byte cache line.
+class Cube {
+public:
+    static const int WORDS = 4;
+    static const int MAX_VARS = WORDS * 64;
+
+    uint64_t value[WORDS] = {0, 0, 0, 0};
+    uint64_t care[WORDS] = {0, 0, 0, 0};
+
+    //  Constructors
+    Cube() = default;
+    static Cube fromString(const std::string& bits);
+    static Cube fromMinterm(int decimal, int numVars);
+
+    // Maps a decimal minterm to variable order (variable 0 is the MSB) and back
+    static uint64_t reverseBits(uint64_t x, int numVars);
+
+    //  Conversions
+    std::string toString(int numVars) const;
+
+    //  Literal access
+    char literal(int var) const {
+        uint64_t bit = uint64_t(1) << (var & 63);
+        int w = var >> 6;
+        if (!(care[w] & bit)) return '-';
+        return (value[w] & bit) ? '1' : '0';
+    }
+    void setLiteral(int var, char c);
+
+    //  Counting
+    int countOnes() const {
+        int n = 0;
+        for (int w = 0; w < WORDS; w++) n += __builtin_popcountll(value[w]);
+        return n;
+    }
+    int countLiterals() const {
+        int n = 0;
+        for (int w = 0; w < WORDS; w++) n += __builtin_popcountll(care[w]);
+        return n;
+    }
+
+    //  Containment and intersection
+    bool contains(const Cube& other) const {
+        for (int w = 0; w < WORDS; w++) {
+            if (care[w] & ~other.care[w]) return false;
+            if ((value[w] ^ other.value[w]) & care[w]) return false;
+        }
+        return true;
+    }
+    bool intersects(const Cube& other) const {
+        for (int w = 0; w < WORDS; w++) {
+            if ((value[w] ^ other.value[w]) & care[w] & other.care[w]) return false;
+        }
+        return true;
+    }
+    // Only the first word is consulted, so numVars must be at most 31
+    bool containsMinterm(int decimal, int numVars) const {
+        uint64_t v = reverseBits(static_cast<uint64_t>(decimal), numVars);
+        return ((v ^ value[0]) & care[0]) == 0;
+    }
+
+    //  QM adjacency: same don't-care positions and exactly one differing value bit
+    bool isAdjacent(const Cube& other) const {
+        int diff = 0;
+        for (int w = 0; w < WORDS; w++) {
+            if (care[w] != other.care[w]) return false;
+            diff += __builtin_popcountll(value[w] ^ other.value[w]);
+        }
+        return diff == 1;
+    }
+
+    //  Merge two adjacent cubes: the differing variable becomes a don't-care
+    Cube merge(const Cube& other) const {
+        Cube r;
+        for (int w = 0; w < WORDS; w++) {
+            uint64_t diff = value[w] ^ other.value[w];
+            r.care[w] = care[w] & ~diff;
+            r.value[w] = value[w] & ~diff;
+        }
+        return r;
+    }
+
+    size_t hash() const {
+        uint64_t h = 0x9e3779b97f4a7c15ULL;
+        for (int w = 0; w < WORDS; w++) {
+            h ^= value[w] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= care[w] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        }
+        return static_cast<size_t>(h);
+    }
+
+    //  Utility
+    bool operator==(const Cube& other) const {
+        for (int w = 0; w < WORDS; w++) {
+            if (value[w] != other.value[w] || care[w] != other.care[w]) return false;
+        }
+        return true;
+    }
+    bool operator!=(const Cube& other) const { return !(*this == other); }
+
+    // Same order as comparing the binary strings ('-' < '0' < '1')
+    bool operator<(const Cube& other) const {
+        for (int w = 0; w < WORDS; w++) {
+            uint64_t diff = (value[w] ^ other.value[w]) | (care[w] ^ other.care[w]);
+            if (!diff) continue;
+            uint64_t bit = diff & (~diff + 1);
+            int a = (care[w] & bit) ? ((value[w] & bit) ? 2 : 1) : 0;
+            int b = (other.care[w] & bit) ? ((other.value[w] & bit) ? 2 : 1) : 0;
+            return a < b;
+        }
+        return false;
+    }
+};
+
+// Lazy, ascending range over the decimal minterms covered by a cube.
+// Nothing is materialized: the iterator walks the subsets of the don't-care
+// positions, so a cube costs the same memory no matter how many minterms it has.
+// Minterms are ints, so the cube must have at most 31 variables.
+class MintermRange {
+public:
+    class iterator {
+    public:
+        iterator(int base, int freeMask, bool done) : base(base), freeMask(freeMask), sub(0), done(done) {}
+        int operator*() const { return base | sub; }
+        iterator& operator++() {
+            sub = (sub - freeMask) & freeMask;
+            if (sub == 0) done = true;
+            return *this;
+        }
+        bool operator!=(const iterator& other) const { return done != other.done || sub != other.sub; }
+        bool operator==(const iterator& other) const { return !(*this != other); }
+
+    private:
+        int base;
+        int freeMask;
+        int sub;
+        bool done;
+    };
+
+    MintermRange(const Cube& cube, int numVars);
+
+    iterator begin() const { return iterator(base, freeMask, false); }
+    iterator end() const { return iterator(base, freeMask, true); }
+    size_t size() const { return size_t(1) << __builtin_popcount(static_cast<unsigned>(freeMask)); }
+
+private:
+    int base;
+    int freeMask;
+};
+
+struct CubeHash {
+    size_t operator()(const Cube& c) const { return c.hash(); }
+};
@@ -0,0 +1,85 @@
+#ifndef cube_batch_hpp
+#define cube_batch_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include "cube.hpp"
+
+// One cube tested against many: the scans behind expand, irredundant and
+// reduce. Candidates are stored word by word (value word w of every cube, then
+// the next word), so one vector load brings the same word of 4 (AVX2) or 8
+// (AVX-512) cubes. The instruction set is picked at run time from what the
+// CPU supports, with a scalar loop everywhere else.
+
+class CubeArray {
+public:
+    // Only the words numVars needs are stored
+    explicit CubeArray(int numVars = Cube::MAX_VARS);
+    CubeArray(const std::vector<Cube>& cubes, int numVars);
+
+    void push_back(const Cube& c);
+    void set(size_t i, const Cube& c);
+    void clear();
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    int words() const { return numWords; }
+
+    const uint64_t* values(int w) const { return value[w].data(); }
+    const uint64_t* cares(int w) const { return care[w].data(); }
+
+private:
+    int numWords;
+    size_t count = 0;
+    std::vector<uint64_t> value[Cube::WORDS];
+    std::vector<uint64_t> care[Cube::WORDS];
+};
+
+// Bit i % 64 of word i / 64 is set when candidate i matches
+typedef std::vector<uint64_t> MatchMask;
+
+enum class CubeKernel { Scalar, Avx2, Avx512 };
+
+const char* cubeKernelName(CubeKernel kernel);
+
+// Kernel in use: the widest the CPU supports, unless overridden
+CubeKernel cubeKernel();
+
+// Forces a kernel (for tests and benchmarks); false, with nothing changed, if
+// the CPU does not support it. Safe while other threads match: each call uses
+// the kernel in use when it started
+bool setCubeKernel(CubeKernel kernel);
+
+// Candidates d with c.intersects(d)
+void matchIntersects(const Cube& c, const CubeArray& candidates, MatchMask& mask);
+
+// Candidates d with c.contains(d)
+void matchContainedIn(const Cube& c, const CubeArray& candidates, MatchMask& mask);
+
+// Candidates d with d.contains(c)
+void matchContaining(const Cube& c, const CubeArray& candidates, MatchMask& mask);
+
+// Candidates d with c.isAdjacent(d): same care bits, values one bit apart
+void matchAdjacent(const Cube& c, const CubeArray& candidates, MatchMask& mask);
+
+// Candidates at distance exactly 1 and exactly 2 from c, where the distance
+// is the number of variables both cubes care about and disagree on (bits of
+// (c.value ^ d.value) & c.care & d.care). Distance 0 means they intersect.
+void matchDistance(const Cube& c, const CubeArray& candidates, MatchMask& one, MatchMask& two);
+
+// True if any candidate intersects c; stops at the first block with a match
+bool anyIntersects(const Cube& c, const CubeArray& candidates);
+
+// Calls f(i) for every set bit, in increasing order
+template <class F>
+void forEachMatch(const MatchMask& mask, F f) {
+    for (size_t w = 0; w < mask.size(); w++) {
+        uint64_t bits = mask[w];
+        while (bits) {
+            f(w * 64 + static_cast<size_t>(__builtin_ctzll(bits)));
+            bits &= bits - 1;
+        }
+    }
+}
+
+#endif /* cube_batch_hpp */
@@ -0,0 +1,49 @@
+#ifndef cubeops_hpp
+#define cubeops_hpp
+
+#include "cube.hpp"
+#include "cancel.hpp"
+#include <vector>
+
+// Cube calculus over covers (lists of cubes), all in packed form.
+// Nothing here enumerates minterms, so cost follows the size of the covers.
+
+// Cubes of F that meet c, with c's variables turned into don't-cares
+std::vector<Cube> cofactor(const std::vector<Cube>& F, const Cube& c);
+
+// Cover of the complement of F (unate recursive paradigm, Shannon splitting).
+// With maxCubes > 0, throws MemoryBudgetExceeded once a partial result has more cubes.
+std::vector<Cube> complement(const std::vector<Cube>& F, int numVars, size_t maxCubes = 0);
+
+// Smallest cube containing every cube of F (F must not be empty)
+Cube supercube(const std::vector<Cube>& F);
+
+// Number of variables where a and b have opposite literals
+int distance(const Cube& a, const Cube& b);
+
+// Consensus of a and b: their intersection at distance 0, the cube spanning
+// the clash at distance 1. Returns false when they are further apart.
+bool consensus(const Cube& a, const Cube& b, Cube& result);
+
+// Does F cover every minterm? Shannon splitting on the most binate variable;
+// unate variables are reduced away and a unate leaf is decided without splitting.
+bool isTautology(const std::vector<Cube>& F, int numVars);
+
+// Is cube c contained in the union of F?
+bool coversCube(const std::vector<Cube>& F, const Cube& c, int numVars);
+
+// Smallest cube containing the complement of F, without building the complement.
+// Returns false when the complement is empty (F is a tautology).
+bool supercubeOfComplement(const std::vector<Cube>& F, int numVars, Cube& result);
+
+// Every prime implicant of F, by iterated consensus: consensus terms of
+// distance-1 pairs are added until none is new, and a cube contained in
+// another is dropped as soon as it appears. Works on F's cubes directly, so
+// the cost follows the number of primes rather than 2^numVars. Sorted.
+// With maxCubes > 0, throws MemoryBudgetExceeded once more cubes are held.
+// When cancel fires it stops early: every cube returned is still an implicant
+// of F and every cube of F is inside one of them, but they need not be prime.
+std::vector<Cube> allPrimes(const std::vector<Cube>& F, int numVars, size_t maxCubes = 0,
+                            const CancelToken* cancel = nullptr);
+
+#endif /* cubeops_hpp */
@@ -5,40 +5,131 @@
 #include <stdio.h>
 
 #include <vector>
+#include <random>
 #include "term.hpp"
+#include "cancel.hpp"
 
 using namespace std;
 
-// Structure to represent a PLA table (input-output pairs)
+// Output part of a multi-output cube, packed like the input part:
+// bit k set = the product term feeds output k (up to Cube::MAX_VARS outputs)
+struct OutputMask {
+    uint64_t bits[Cube::WORDS] = {0, 0, 0, 0};
+
+    void set(int k) { bits[k >> 6] |= uint64_t(1) << (k & 63); }
+    void reset(int k) { bits[k >> 6] &= ~(uint64_t(1) << (k & 63)); }
+    bool test(int k) const { return (bits[k >> 6] >> (k & 63)) & 1; }
+    int count() const {
+        int n = 0;
+        for (int w = 0; w < Cube::WORDS; w++) n += __builtin_popcountll(bits[w]);
+        return n;
+    }
+    bool any() const { return count() > 0; }
+    bool contains(const OutputMask& other) const {
+        for (int w = 0; w < Cube::WORDS; w++) {
+            if (other.bits[w] & ~bits[w]) return false;
+        }
+        return true;
+    }
+    void unite(const OutputMask& other) {
+        for (int w = 0; w < Cube::WORDS; w++) bits[w] |= other.bits[w];
+    }
+    bool operator==(const OutputMask& other) const {
+        for (int w = 0; w < Cube::WORDS; w++) {
+            if (bits[w] != other.bits[w]) return false;
+        }
+        return true;
+    }
+};
+
+// Structure to represent a PLA table (input-output pairs):
+// an input cube plus the outputs it belongs to
 
 struct PLACube {
     Term term;
-    string outputBits;
-
-    PLACube(const Term& t, const string& out)
-        : term(t), outputBits(out) {}
+    OutputMask outputs;
+
+    PLACube(const Term& t, const OutputMask& out)
+        : term(t), outputs(out) {}
+
+    // outputBits is a PLA output column; positions equal to 'mark' are set
+    PLACube(const Term& t, const string& outputBits, char mark = '1')
+        : term(t) {
+        for (size_t k = 0; k < outputBits.size(); k++) {
+            if (outputBits[k] == mark) outputs.set(static_cast<int>(k));
+        }
+    }
 };
 
-// Reads PLA format and returns cubes for each output function
+// Splits multi-output cubes into the cover of each output function
 
 vector<vector<PLACube>> groupByOutput(const vector<PLACube>& cubes, int numOutputs);
 
-// Core Espresso function: takes grouped cubes and returns minimized result
+// Core Espresso function: takes the on-set and dc-set covers and returns a
+// prime, irredundant cover. Cubes may have don't-cares; nothing is expanded to minterms.
+
+vector<Term> runEspressoOnce(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars, unsigned seed = 1);
+
+// Multi-pass settings. Pass i runs with a seed derived from (seed, i), so a
+// given seed gives the same cover for any thread count.
+struct EspressoOptions {
+    int passes = 5;
+    unsigned seed = 1;
+    int numThreads = 1;         // 0 = one per hardware thread
+    int stopAfterStall = 0;     // stop once this many passes in a row fail to improve (0 = run all)
+    double timeLimitSeconds = 0; // start no new wave of passes after this long (0 = no limit)
+    size_t memoryBudgetBytes = 0;   // OFF-set budget; past it MemoryBudgetExceeded is thrown (0 = none)
+    const CancelToken* cancel = nullptr;    // when it fires, passes stop and the best cover so far is kept
+};
 
-vector<Term> runEspressoOnce(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars);
+// Runs independent passes concurrently and keeps the cover with the fewest literals
+vector<Term> runEspressoMultiple(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars, const EspressoOptions& options);
 
 vector<Term> runEspressoMultiple(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars, int passes) ;
 
+// Rows added to or removed from one output since a cover was computed
+struct CoverDelta {
+    vector<Term> addedOn, removedOn;
+    vector<Term> addedDc, removedDc;
+};
+
+// Incremental re-minimization. previous is a cover of the function before the
+// delta; onSet and dcSet describe it after. Only the cubes the delta touches
+// and their neighbours are reworked (raised against on + dc, so no OFF-set is
+// built); the result is a valid, irredundant cover of the new function.
+vector<Term> updateCover(const vector<Term>& previous, const vector<Term>& onSet, const vector<Term>& dcSet,
+                         const CoverDelta& delta, int numVars);
+
+// Shared multi-output minimization. The output part travels with each cube, so a
+// product term used by several outputs is expanded and stored once. Returns
+// every product term once, with all the outputs it feeds. The memory budget
+// covers the OFF-sets of all outputs together.
+vector<PLACube> runEspressoMultiOutput(const vector<PLACube>& onSet, const vector<PLACube>& dcSet,
+                                       int numVars, int numOutputs, const EspressoOptions& options);
+
 // Utility function to convert minimized cubes to SOP string
 
 vector<string> espressoTermsToSOP(const vector<vector<Term>>& result, int numVars);
 
 // Core functions
 
-vector<Term> expand(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars);
+// OFF-set cover: complement of onSet + dcSet. With a memory budget, throws
+// MemoryBudgetExceeded when the OFF-set would not fit in it.
+vector<Term> complementCover(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars,
+                             size_t memoryBudgetBytes = 0);
+
+// Raise literals of each cube while it stays disjoint from the OFF-set; every result cube is prime.
+// Once cancel fires, the cubes not yet reached are returned as they are.
+vector<Term> expand(const vector<Term>& cover, const vector<Term>& offSet, int numVars, mt19937& rng,
+                    const CancelToken* cancel = nullptr);
+
+// Drop cubes covered by the rest of the cover plus the dc-set
+vector<Term> irredundant(const vector<Term>& cover, const vector<Term>& dcSet, int numVars);
 
-vector<Term> reduce(const vector<Term>& expanded, const vector<Term>& onSet, int numVars);
+// Shrink each cube to the smallest cube still covering what no other cube covers
+vector<Term> reduce(const vector<Term>& cover, const vector<Term>& dcSet, int numVars);
 
-vector<Term> extractEssential(const vector<Term>& reduced, const vector<Term>& onSet, int numVars);
+// Primes of the cover that every cover of the function must contain
+vector<Term> extractEssential(const vector<Term>& cover, const vector<Term>& dcSet, int numVars);
 
 #endif /* espresso_hpp */
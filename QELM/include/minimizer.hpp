@@ -0,0 +1,130 @@
+#ifndef minimizer_hpp
+#define minimizer_hpp
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "term.hpp"
+#include "pla.hpp"
+#include "cache.hpp"
+#include "cancel.hpp"
+
+class ThreadPool;
+
+// Entry point of libqelm: minimizes every output of a parsed PLA with the
+// engine picked per output, without touching files or stdin.
+
+enum class Engine {
+    Auto,       // chosen per output by chooseEngine
+    Quine,      // exact Quine-McCluskey with a bounded cover search (at most 31 variables)
+    Espresso,   // heuristic, outputs minimized together when all of them use it
+    Bdd         // BDD + ISOP, no OFF-set; falls back to Espresso past the node limit
+};
+
+const char* engineName(Engine engine);
+bool parseEngine(const std::string& name, Engine& engine);
+
+struct MinimizerOptions {
+    Engine engine = Engine::Auto;
+    int passes = 5;                 // Espresso passes
+    unsigned seed = 1;              // Espresso seed; same seed, same covers
+    int numThreads = 0;             // 0 = one per hardware thread
+    double timeBudgetSeconds = 0;   // per output: limits the QM cover search and Espresso passes (0 = none)
+    bool shareOutputs = true;       // let Espresso outputs share product terms
+    std::string cacheDirectory;     // on-disk result cache, empty = no cache
+    uint64_t cacheMaxBytes = uint64_t(256) << 20;
+    // Bytes the engines' large tables may take, split between the outputs
+    // minimized at the same time (0 = no limit). An engine that would pass it
+    // gives way to a cheaper one; see OutputCover::memoryFellBack.
+    size_t memoryBudgetBytes = 0;
+    // Polled by every engine but BDD; once it fires each output returns the
+    // best cover found so far (see OutputCover::cancelled). Must outlive the
+    // calls that use it; null = never cancelled.
+    const CancelToken* cancel = nullptr;
+};
+
+struct OutputCover {
+    std::vector<Term> cover;
+    Engine engine = Engine::Quine;  // engine that produced the cover
+    bool provenMinimal = false;     // QM finished its cover search
+    bool bddFellBack = false;       // BDD hit its node limit, Espresso was used
+    bool fromCache = false;         // read from the result cache
+    bool memoryFellBack = false;    // memory budget reached: engine is the cheaper engine that ran instead
+    bool inputKept = false;         // no engine fit the budget: the cover is the input on-set, unminimized
+    bool cancelled = false;         // the cancel token fired first: best cover so far, not a finished run
+};
+
+struct MinimizeResult {
+    std::vector<OutputCover> outputs;
+    size_t productTerms = 0;        // distinct product terms over all outputs
+    bool shared = false;            // outputs were minimized together
+    bool sharingDropped = false;    // the shared run passed the memory budget: outputs went one by one
+    double engineSeconds = 0;       // time the engines took, summed over the tasks that ran them
+};
+
+class Minimizer {
+public:
+    explicit Minimizer(const MinimizerOptions& options = MinimizerOptions());
+
+    MinimizeResult minimize(const PLAFile& pla) const;
+
+    // Called once with the result, or with the first exception an output threw
+    typedef std::function<void(MinimizeResult result, std::exception_ptr error)> AsyncDone;
+
+    // Same covers as minimize, but queued on pool as one task per output (one
+    // for a shared Espresso run) and returned at once; done runs on the worker
+    // that finishes last. Never waits on the pool, so tasks of the same pool
+    // may call it. Every task runs single-threaded, so options.numThreads is
+    // not used, and the memory budget is split across the pool's workers.
+    // The minimizer and the pool must outlive the call's tasks.
+    void minimizeAsync(std::shared_ptr<const PLAFile> pla, ThreadPool& pool, AsyncDone done) const;
+
+    // One function; engine Auto is resolved with chooseEngine.
+    // Throws std::invalid_argument when Quine is forced on more than 31 variables.
+    OutputCover minimizeFunction(const std::vector<Term>& onSet, const std::vector<Term>& dcSet,
+                                 int numVars) const;
+
+    // Re-minimizes after an edit: previous is the result for the PLA before
+    // delta, pla the PLA after it. Outputs the delta does not touch keep their
+    // covers; the others go through updateCover and are reported as Espresso
+    // covers, not proven minimal, with the other flags cleared. Falls back to a
+    // full minimize when the shape of the PLA (input or output count) changed.
+    MinimizeResult update(const MinimizeResult& previous, const PLAFile& pla, const PLADelta& delta) const;
+
+    // Cost model. QM when the care set (on + dc minterms, counted from the cube
+    // sizes) is small enough for the prime chart; BDD for thousands of
+    // near-minterm cubes, where Espresso's OFF-set complement is the bottleneck;
+    // Espresso otherwise.
+    static Engine chooseEngine(const std::vector<Term>& onSet, const std::vector<Term>& dcSet, int numVars);
+
+    const MinimizerOptions& getOptions() const { return options; }
+
+private:
+    // Per-output ON and DC sets of a PLA and the engine each one gets
+    struct Plan {
+        std::vector<std::vector<Term>> onSets;
+        std::vector<std::vector<Term>> dcSets;
+        std::vector<Engine> engines;
+        bool shared = false;    // every output goes through one shared Espresso run
+    };
+    Plan plan(const PLAFile& pla) const;
+    // The shared Espresso run, or its cache entry; false when it passed the
+    // memory budget and the outputs have to go one by one
+    bool minimizeShared(const PLAFile& pla, const Plan& p, int numThreads, size_t memoryBudget,
+                        MinimizeResult& result) const;
+    OutputCover run(const std::vector<Term>& onSet, const std::vector<Term>& dcSet, int numVars,
+                    Engine engine, int numThreads, size_t memoryBudget) const;
+    OutputCover compute(const std::vector<Term>& onSet, const std::vector<Term>& dcSet, int numVars,
+                        Engine engine, int numThreads, size_t memoryBudget) const;
+    // Options that change the cover, as part of a cache key
+    std::string cacheTag(Engine engine) const;
+
+    MinimizerOptions options;
+    std::shared_ptr<ResultCache> cache;     // null without a cache directory
+};
+
+#endif /* minimizer_hpp */
@@ -0,0 +1,45 @@
+#ifndef pla_hpp
+#define pla_hpp
+
+#include <string>
+#include <vector>
+
+#include "term.hpp"
+#include "espresso.hpp"
+
+// A parsed PLA. Rows keep their input cubes ('-' stays a don't-care) and
+// carry the set of outputs they belong to.
+struct PLAFile {
+    int numVars = 0;
+    int numOutputs = 1;
+    std::string type = "fd";            // f, fd, fr or fdr
+    size_t declaredProducts = 0;        // .p, 0 if absent; a mismatch with the rows read only warns
+    std::vector<std::string> inputLabels;
+    std::vector<std::string> outputLabels;
+
+    std::vector<PLACube> onRows;        // rows marking an output '1'
+    std::vector<PLACube> dcRows;        // rows marking an output '-' (plus implied dc for fr/fdr)
+    std::vector<PLACube> offRows;       // rows marking an output '0' (fr/fdr only)
+};
+
+// Reads a PLA in a single pass over a memory-mapped file.
+// Supports .i .o .p .ilb .ob .type .e; for .type fr/fdr every minterm not in
+// the on-, dc- or off-set of an output is added to its dc-set.
+// Prints the reason to cerr and returns false on error.
+bool parsePLA(const std::string& filename, PLAFile& pla);
+
+// Per-output covers (input cubes only) of a list of multi-output rows
+std::vector<std::vector<Term>> splitByOutput(const std::vector<PLACube>& rows, int numOutputs);
+
+// Rows that changed between two versions of a PLA, one output per row
+struct PLADelta {
+    std::vector<PLACube> addedOn, removedOn;
+    std::vector<PLACube> addedDc, removedDc;
+
+    bool empty() const { return addedOn.empty() && removedOn.empty() && addedDc.empty() && removedDc.empty(); }
+};
+
+// Row-by-row difference of the on- and dc-sets; rows are matched as a multiset
+PLADelta diffPLA(const PLAFile& before, const PLAFile& after);
+
+#endif /* pla_hpp */
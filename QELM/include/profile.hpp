@@ -0,0 +1,76 @@
+#ifndef profile_hpp
+#define profile_hpp
+
+#include <cstdint>
+#include <string>
+
+// Phase timers and work counters for the minimizers. They only exist when the
+// library is built with QELM_PROFILE defined (make PROFILE=1); otherwise the
+// macros below expand to nothing and cost nothing.
+
+enum class ProfilePhase {
+    Combine,        // combineTerms rounds
+    Consensus,      // allPrimes on cube-form input
+    Chart,          // QM prime chart and essential primes
+    CoverSearch,    // branch and bound over the cyclic core (Petrick's step)
+    Complement,     // OFF-set computation
+    Expand,
+    Irredundant,
+    Reduce,
+    Essential,      // extractEssential
+    Bdd,            // whole BDD engine run; its reduce and irredundant steps also count on their own
+    Count
+};
+
+enum class ProfileCounter {
+    CubesGenerated,     // cubes produced by combine rounds and expand
+    MergesAttempted,    // partner lookups in combine rounds
+    MergesSucceeded,
+    SetInsertions,      // insertions into the combine hash tables
+    PeakCoverSize,      // largest term list seen by a QM round or Espresso pass (a maximum)
+    Count
+};
+
+#ifdef QELM_PROFILE
+
+#include <chrono>
+
+// Adds the time from construction to destruction to a phase. Totals are summed
+// over threads, so a parallel phase can report more time than the wall clock.
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePhase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfilePhase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+void profileAdd(ProfileCounter counter, uint64_t n);
+void profileMax(ProfileCounter counter, uint64_t n);
+
+// Clears every timer and counter
+void resetProfile();
+
+// Writes the timers and counters as a JSON object; false if the file cannot be opened
+bool writeProfileReport(const std::string& path);
+
+#define QELM_PROFILE_JOIN2(a, b) a##b
+#define QELM_PROFILE_JOIN(a, b) QELM_PROFILE_JOIN2(a, b)
+#define QELM_PROFILE_SCOPE(phase) ProfileScope QELM_PROFILE_JOIN(profileScope, __LINE__)(ProfilePhase::phase)
+#define QELM_PROFILE_ADD(counter, n) profileAdd(ProfileCounter::counter, static_cast<uint64_t>(n))
+#define QELM_PROFILE_MAX(counter, n) profileMax(ProfileCounter::counter, static_cast<uint64_t>(n))
+
+#else
+
+#define QELM_PROFILE_SCOPE(phase) ((void)0)
+#define QELM_PROFILE_ADD(counter, n) ((void)0)
+#define QELM_PROFILE_MAX(counter, n) ((void)0)
+
+#endif
+
+#endif /* profile_hpp */
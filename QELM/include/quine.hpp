@@ -2,13 +2,37 @@
 #define quine_hpp
 
 #include "term.hpp"
+#include "cover.hpp"
 #include <vector>
 #include <set>
 #include <string>
 
-std::vector<Term> runQuine(const std::vector<Term>& minterms, const std::vector<Term>& dontCares);
+// Counters of one runQuine call
+struct QuineStats {
+    int rounds = 0;             // combining rounds, including the last one that changed nothing
+    bool consensus = false;     // primes came from iterated consensus on the input cubes (no rounds)
+    bool cancelled = false;     // coverOptions.cancel fired before the primes were complete
+    size_t primes = 0;          // prime implicants found
+    size_t coreRows = 0;        // chart rows left once essential primes are taken
+    size_t coverNodes = 0;      // branch-and-bound nodes spent on the cyclic core
+};
 
-std::string termsToSOP(const std::vector<Term>& terms, int numVars);
+// The input may be minterms or cubes. Large cubes go straight to iterated
+// consensus (allPrimes); otherwise they are split into minterms and combined.
+// numThreads is passed to every combineTerms round (0 = one per hardware thread).
+// The cyclic core of the prime chart goes to solveCover under coverOptions;
+// provenOptimal (if given) is set to false when its budget ran out.
+// coverOptions.cancel is also polled between combining rounds and by the
+// consensus passes; a run it cuts short returns the best cover it can make
+// from the implicants found so far, never proven optimal.
+// With memoryBudget > 0 (bytes), throws MemoryBudgetExceeded when the term
+// lists or the prime chart would not fit in it.
+std::vector<Term> runQuine(const std::vector<Term>& minterms, const std::vector<Term>& dontCares, int numThreads = 1,
+                           const CoverOptions& coverOptions = CoverOptions(), bool* provenOptimal = nullptr,
+                           QuineStats* stats = nullptr, size_t memoryBudget = 0);
+
+// Labels as in inputNames: A, B, ... by default
+std::string termsToSOP(const std::vector<Term>& terms, int numVars, const std::vector<std::string>& labels = {});
 
 
 #endif /* quine_hpp */
@@ -2,17 +2,21 @@
 
 #include <string>
 #include <vector>
-#include <set>
+
+#include "cube.hpp"
 
 class Term {
 public:
     //  Constructors
     Term(int decimal, int numVars, bool isDontCare = false);
-    Term(const std::string& binString, std::set<int> covered, bool isDontCare = false);
+    Term(const std::string& binString, bool isDontCare = false);
+    Term(const Cube& cube, int numVars, bool isDontCare = false);
 
     //  Getters
     std::string getBinary() const;
-    std::set<int> getCoveredMinterms() const;
+    const Cube& getCube() const { return cube; }
+    int getNumVars() const { return numVars; }
+    MintermRange getCoveredMinterms() const;
     bool isUsed() const;
     bool isDontCareTerm() const;
 
@@ -23,14 +27,20 @@ public:
     bool canCombineWith(const Term& other) const;
     Term combineWith(const Term& other) const;
     int countOnes() const;
+    int countLiterals() const;
+
+    //  Coverage, computed from the cube instead of stored
+    bool coversMinterm(int decimal) const;
+    bool contains(const Term& other) const;
+    bool intersects(const Term& other) const;
 
     //  Utility
     bool operator==(const Term& other) const;
     bool operator<(const Term& other) const;
 
 private:
-    std::string binary;
-    std::set<int> coveredMinterms;
+    Cube cube;
+    int numVars = 0;
     bool used = false;
     bool isDontCare = false;
 };
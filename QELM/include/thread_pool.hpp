@@ -0,0 +1,62 @@
+#ifndef thread_pool_hpp
+#define thread_pool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool: every worker owns a deque. Tasks submitted from a worker
+// go to the back of its own deque and are taken LIFO; tasks submitted from
+// outside are dealt round-robin. An idle worker steals from the front of the
+// other deques, so a few long tasks do not leave the rest of the pool idle.
+class ThreadPool {
+public:
+    // numThreads <= 0 means one worker per hardware thread. workerInit, if
+    // given, runs on each worker before its first task (per-thread setup).
+    explicit ThreadPool(int numThreads = 0, std::function<void()> workerInit = nullptr);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    // Queue f and return a future for its result.
+    // Do not block on the future from inside a task of the same pool.
+    template <class F>
+    auto submit(F&& f) -> std::future<decltype(f())> {
+        using Result = decltype(f());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+        std::future<Result> result = task->get_future();
+        push([task]() { (*task)(); });
+        return result;
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void push(std::function<void()> task);
+    bool pop(int self, std::function<void()>& task);
+    void workerLoop(int self);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::function<void()> workerInit;
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<size_t> pending{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable ready;
+    bool stopping = false;
+};
+
+#endif /* thread_pool_hpp */
@@ -0,0 +1,103 @@
+#ifndef writer_hpp
+#define writer_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "term.hpp"
+#include "pla.hpp"
+#include "minimizer.hpp"
+
+// Writers for minimized covers: the text report, a standard PLA and a binary
+// cube list. Everything is formatted straight from the packed cubes into one
+// buffer per file, so no per-cover strings are built on the way.
+
+// Appends to a 64 KB buffer and writes it to the file a block at a time
+class FileWriter {
+public:
+    explicit FileWriter(const std::string& path);
+    ~FileWriter();
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    bool ok() const { return fd >= 0 && !failed; }
+
+    void push_back(char c) {
+        if (used == buffer.size()) flush();
+        buffer[used++] = c;
+    }
+    void append(const char* text, size_t length);
+    void append(const std::string& text) { append(text.data(), text.size()); }
+    void appendNumber(uint64_t n);
+    // The low 'bytes' bytes of word, least significant first
+    void appendLittleEndian(uint64_t word, int bytes);
+
+    // Writes what is left and closes the file; false if any write failed
+    bool close();
+
+private:
+    void flush();
+
+    int fd = -1;
+    bool failed = false;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+
+// Names of the input variables: the .ilb labels when there is one per input,
+// otherwise A, B, ... up to 26 inputs and x0, x1, ... past that
+std::vector<std::string> inputNames(int numVars, const std::vector<std::string>& labels = {});
+
+// Appends a cover as a sum of products ("AB' + C"). Literals are joined
+// directly when every name is one character, with spaces otherwise.
+// Sink is anything with append(const char*, size_t), append(std::string) and
+// push_back(char): std::string or FileWriter.
+template <class Sink>
+void appendSOP(Sink& out, const std::vector<Term>& terms, const std::vector<std::string>& names) {
+    bool spaced = false;
+    for (const std::string& name : names) spaced |= name.size() != 1;
+
+    for (size_t i = 0; i < terms.size(); i++) {
+        if (i > 0) out.append(" + ", 3);
+        const Cube& cube = terms[i].getCube();
+        bool first = true;
+        for (size_t j = 0; j < names.size(); j++) {
+            char lit = cube.literal(static_cast<int>(j));
+            if (lit == '-') continue;
+            if (spaced && !first) out.push_back(' ');
+            out.append(names[j]);
+            if (lit == '0') out.push_back('\'');
+            first = false;
+        }
+    }
+}
+
+// The report qelm writes by default: engine and notes per output, then its SOP
+bool writeReport(const std::string& path, const PLAFile& pla, const MinimizeResult& result);
+
+// The covers as a PLA of type f: .i/.o, the .ilb/.ob labels of the input, .p,
+// one row per distinct product term with a 1 for every output it feeds, .e
+// False if the file cannot be written or there are more than Cube::MAX_VARS
+// outputs, the most a PLA row holds.
+bool writeResultPLA(const std::string& path, const PLAFile& pla, const MinimizeResult& result);
+
+// Binary cube list, all integers little-endian:
+//   "QELMCB1\n", u32 numVars, u32 numOutputs, u32 label count (0 or
+//   numVars + numOutputs), then each label as u32 length + bytes (inputs first),
+//   u64 row count, then per row the value words, the care words and the output
+//   words, (numVars + 63) / 64 and (numOutputs + 63) / 64 u64 words each.
+// Rows and limits are the same as in writeResultPLA.
+bool writeCubeList(const std::string& path, const PLAFile& pla, const MinimizeResult& result);
+
+// Writes result in format "report", "pla" or "binary" with the writer above.
+// Throws std::invalid_argument for any other format.
+bool writeResult(const std::string& path, const std::string& format, const PLAFile& pla,
+                 const MinimizeResult& result);
+
+// Reads a cube list back as a PLA of type f, the rows in onRows.
+// Prints the reason to cerr and returns false on error.
+bool readCubeList(const std::string& path, PLAFile& pla);
+
+#endif /* writer_hpp */
@@ -0,0 +1,128 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+static thread_local pmr::memory_resource* currentScratch = nullptr;
+
+// Chunks released by this thread's arenas, kept for its next ones. Reuse
+// needs an exact size match, which the pools' fixed growth sequence gives.
+struct ChunkCache {
+    struct Chunk {
+        void* p;
+        size_t bytes;
+        size_t alignment;
+    };
+    vector<Chunk> chunks;
+    size_t bytes = 0;
+    size_t maxBytes = 0;
+
+    ~ChunkCache() { trim(0); }
+
+    void* take(size_t n, size_t alignment) {
+        for (size_t i = chunks.size(); i-- > 0;) {
+            if (chunks[i].bytes == n && chunks[i].alignment == alignment) {
+                void* p = chunks[i].p;
+                chunks[i] = chunks.back();
+                chunks.pop_back();
+                bytes -= n;
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    bool keep(void* p, size_t n, size_t alignment) {
+        if (bytes + n > maxBytes) return false;
+        chunks.push_back({p, n, alignment});
+        bytes += n;
+        return true;
+    }
+
+    void trim(size_t limit) {
+        while (bytes > limit) {
+            Chunk c = chunks.back();
+            chunks.pop_back();
+            pmr::new_delete_resource()->deallocate(c.p, c.bytes, c.alignment);
+            bytes -= c.bytes;
+        }
+    }
+};
+
+static thread_local ChunkCache chunkCache;
+
+static mutex hookMutex;
+static function<void(const ArenaStats&)> statsHook;
+
+void* Arena::CountingResource::do_allocate(size_t n, size_t alignment) {
+    void* p = chunkCache.take(n, alignment);
+    if (p) {
+        stats.reusedChunks++;
+    } else {
+        p = pmr::new_delete_resource()->allocate(n, alignment);
+        stats.chunks++;
+    }
+    bytes += n;
+    stats.peakBytes = max(stats.peakBytes, bytes);
+    return p;
+}
+
+void Arena::CountingResource::do_deallocate(void* p, size_t n, size_t alignment) {
+    if (!chunkCache.keep(p, n, alignment)) pmr::new_delete_resource()->deallocate(p, n, alignment);
+    bytes -= n;
+}
+
+bool Arena::CountingResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+Arena::Arena(const char* run) : pools(&upstream) {
+    upstream.stats.run = run;
+}
+
+Arena::~Arena() {
+    pools.release();
+    function<void(const ArenaStats&)> hook;
+    {
+        lock_guard<mutex> lock(hookMutex);
+        hook = statsHook;
+    }
+    if (hook) hook(upstream.stats);
+}
+
+void* Arena::do_allocate(size_t n, size_t alignment) {
+    return pools.allocate(n, alignment);
+}
+
+void Arena::do_deallocate(void* p, size_t n, size_t alignment) {
+    pools.deallocate(p, n, alignment);
+}
+
+bool Arena::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+ArenaScope::ArenaScope(const char* run) : arena(run), previous(currentScratch) {
+    currentScratch = &arena;
+}
+
+ArenaScope::~ArenaScope() {
+    currentScratch = previous;
+}
+
+pmr::memory_resource* scratchResource() {
+    return currentScratch ? currentScratch : pmr::new_delete_resource();
+}
+
+void setArenaChunkCache(size_t maxBytes) {
+    chunkCache.maxBytes = maxBytes;
+    chunkCache.trim(maxBytes);
+}
+
+void setArenaStatsHook(function<void(const ArenaStats&)> hook) {
+    lock_guard<mutex> lock(hookMutex);
+    statsHook = move(hook);
+}
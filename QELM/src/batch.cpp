@@ -0,0 +1,236 @@
+#include "batch.hpp"
+#include "arena.hpp"
+#include "thread_pool.hpp"
+#include "writer.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Arena chunks each worker keeps between runs: most scratch tables of small
+// PLAs fit, so back-to-back files reuse chunks instead of going to the heap
+static const size_t BATCH_ARENA_CACHE_BYTES = size_t(8) << 20;
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool collectBatchInputs(const vector<string>& args, vector<string>& files) {
+    for (const string& arg : args) {
+        if (arg.size() > 1 && arg[0] == '@') {
+            ifstream list(arg.substr(1));
+            if (!list) {
+                cerr << "Error opening input list " << arg.substr(1) << "\n";
+                return false;
+            }
+            string line;
+            while (getline(list, line)) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty()) files.push_back(line);
+            }
+            continue;
+        }
+
+        error_code ec;
+        if (!fs::is_directory(arg, ec)) {
+            files.push_back(arg);
+            continue;
+        }
+        vector<string> found;
+        for (fs::directory_iterator it(arg, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->path().extension() == ".pla" && it->is_regular_file(ec)) found.push_back(it->path().string());
+        }
+        if (ec) {
+            cerr << "Error reading directory " << arg << ": " << ec.message() << "\n";
+            return false;
+        }
+        sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return true;
+}
+
+static const char* formatExtension(const string& format) {
+    if (format == "pla") return ".pla";
+    if (format == "binary") return ".qcb";
+    return ".txt";
+}
+
+// Output path per input: its stem in the output directory, made unique
+static vector<string> outputPaths(const vector<string>& files, const BatchOptions& options) {
+    map<string, int> uses;
+    vector<string> paths;
+    for (const string& file : files) {
+        string stem = fs::path(file).stem().string();
+        int n = ++uses[stem];
+        if (n > 1) stem += "-" + to_string(n);
+        paths.push_back((fs::path(options.outputDirectory) / (stem + formatExtension(options.format))).string());
+    }
+    return paths;
+}
+
+static bool samePath(const string& a, const string& b) {
+    error_code ec;
+    fs::path pa = fs::weakly_canonical(a, ec);
+    if (ec) return false;
+    fs::path pb = fs::weakly_canonical(b, ec);
+    return !ec && pa == pb;
+}
+
+// Fills in a file's entry from its result and writes the output
+static void finishFile(BatchFileResult& file, const string& outputPath, const string& format, const PLAFile& pla,
+                       const MinimizeResult& result) {
+    file.engineSeconds = result.engineSeconds;
+    file.productTerms = result.productTerms;
+    for (const OutputCover& out : result.outputs) {
+        file.literals += countLiterals(out.cover);
+        file.cancelled |= out.cancelled;
+    }
+
+    auto start = chrono::steady_clock::now();
+    if (writeResult(outputPath, format, pla, result)) file.output = outputPath;
+    else file.error = "cannot write " + outputPath;
+    file.writeSeconds = secondsSince(start);
+}
+
+// Calls done once, when the last copy of the guard goes: the file's task and,
+// once the minimizer has the file, its completion callback share it
+class FileGuard {
+public:
+    explicit FileGuard(function<void()> done) : done(move(done)) {}
+    ~FileGuard() { done(); }
+
+    FileGuard(const FileGuard&) = delete;
+    FileGuard& operator=(const FileGuard&) = delete;
+
+private:
+    function<void()> done;
+};
+
+BatchSummary runBatch(const vector<string>& files, const BatchOptions& options) {
+    auto start = chrono::steady_clock::now();
+    BatchSummary summary;
+    summary.files.resize(files.size());
+    for (size_t k = 0; k < files.size(); k++) summary.files[k].input = files[k];
+
+    error_code ec;
+    fs::create_directories(options.outputDirectory, ec);
+    vector<string> outputs = outputPaths(files, options);
+
+    // Files still in flight; the calling thread sleeps until none are left
+    mutex doneMutex;
+    condition_variable allDone;
+    size_t left = files.size();
+    auto fileDone = [&]() {
+        lock_guard<mutex> lock(doneMutex);
+        if (--left == 0) allDone.notify_all();
+    };
+
+    Minimizer minimizer(options.minimizer);
+    {
+        // Declared after everything its tasks use, so it joins its workers first
+        ThreadPool pool(options.minimizer.numThreads, []() { setArenaChunkCache(BATCH_ARENA_CACHE_BYTES); });
+        summary.threads = pool.size();
+
+        for (size_t k = 0; k < files.size(); k++) {
+            pool.submit([&, k]() {
+                BatchFileResult& file = summary.files[k];
+                // The file is done once this task and, if it gets that far,
+                // the minimizer's callback have both let go of the guard
+                auto guard = make_shared<FileGuard>(fileDone);
+                try {
+                    if (ec) {
+                        file.error = "cannot create " + options.outputDirectory + ": " + ec.message();
+                        return;
+                    }
+                    if (samePath(files[k], outputs[k])) {
+                        file.error = "output would replace the input";
+                        return;
+                    }
+
+                    auto parseStart = chrono::steady_clock::now();
+                    auto pla = make_shared<PLAFile>();
+                    if (!parsePLA(files[k], *pla)) {
+                        file.error = "cannot parse input";
+                        return;
+                    }
+                    file.parseSeconds = secondsSince(parseStart);
+                    file.numVars = pla->numVars;
+                    file.numOutputs = pla->numOutputs;
+
+                    minimizer.minimizeAsync(pla, pool, [&, k, pla, guard](MinimizeResult result, exception_ptr error) {
+                        BatchFileResult& file = summary.files[k];
+                        try {
+                            if (error) rethrow_exception(error);
+                            finishFile(file, outputs[k], options.format, *pla, result);
+                        } catch (const exception& e) {
+                            file.error = e.what();
+                        } catch (...) {
+                            file.error = "minimization failed";
+                        }
+                    });
+                } catch (const exception& e) {
+                    file.error = e.what();
+                } catch (...) {
+                    file.error = "minimization failed";
+                }
+            });
+        }
+
+        unique_lock<mutex> lock(doneMutex);
+        allDone.wait(lock, [&] { return left == 0; });
+    }
+
+    for (const BatchFileResult& file : summary.files) summary.failed += !file.error.empty();
+    summary.wallSeconds = secondsSince(start);
+    return summary;
+}
+
+bool writeBatchSummary(const string& path, const BatchSummary& summary) {
+    FileWriter out(path);
+    if (!out.ok()) return false;
+
+    char number[32];
+    auto appendMillis = [&](double seconds) {
+        int n = snprintf(number, sizeof(number), "%.3f", seconds * 1000);
+        out.append(number, static_cast<size_t>(n));
+    };
+
+    out.append("# Batch summary\n# Files: ");
+    out.appendNumber(summary.files.size());
+    out.append("\n# Failed: ");
+    out.appendNumber(summary.failed);
+    out.append("\n# Threads: ");
+    out.appendNumber(summary.threads);
+    out.append("\n# Wall time (ms): ");
+    appendMillis(summary.wallSeconds);
+    out.append("\nfile\tvars\toutputs\tterms\tliterals\tparse_ms\tengine_ms\twrite_ms\tstatus\n");
+
+    for (const BatchFileResult& file : summary.files) {
+        out.append(file.input);
+        for (size_t n : {size_t(file.numVars), size_t(file.numOutputs), file.productTerms, file.literals}) {
+            out.push_back('\t');
+            out.appendNumber(n);
+        }
+        for (double seconds : {file.parseSeconds, file.engineSeconds, file.writeSeconds}) {
+            out.push_back('\t');
+            appendMillis(seconds);
+        }
+        out.push_back('\t');
+        if (!file.error.empty()) out.append(file.error);
+        else out.append(file.cancelled ? "deadline" : "ok");
+        out.push_back('\n');
+    }
+    return out.close();
+}
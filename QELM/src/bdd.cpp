@@ -0,0 +1,232 @@
+#include "bdd.hpp"
+#include "espresso.hpp"
+#include "utils.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+enum BddOp { OP_AND, OP_OR, OP_NOT };
+
+static size_t hashTriple(uint64_t a, uint64_t b, uint64_t c) {
+    uint64_t h = a * 0x9e3779b97f4a7c15ULL;
+    h ^= b + 0xbf58476d1ce4e5b9ULL + (h << 6) + (h >> 2);
+    h ^= c + 0x94d049bb133111ebULL + (h << 6) + (h >> 2);
+    return static_cast<size_t>(h ^ (h >> 31));
+}
+
+static size_t powerOfTwoAtLeast(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+BddManager::BddManager(int numVars, const vector<int>& order, size_t nodeLimit, size_t cacheSize)
+    : numVars(numVars), order(order), nodeLimit(nodeLimit) {
+    nodes.push_back({numVars, FALSE_NODE, FALSE_NODE});
+    nodes.push_back({numVars, TRUE_NODE, TRUE_NODE});
+    unique.assign(1024, -1);
+    cache.resize(powerOfTwoAtLeast(max<size_t>(cacheSize, 1)));
+}
+
+void BddManager::growUnique() {
+    vector<Node> bigger(unique.size() * 2, -1);
+    size_t mask = bigger.size() - 1;
+    for (Node n = 2; n < static_cast<Node>(nodes.size()); n++) {
+        size_t slot = hashTriple(nodes[n].level, nodes[n].lo, nodes[n].hi) & mask;
+        while (bigger[slot] != -1) slot = (slot + 1) & mask;
+        bigger[slot] = n;
+    }
+    unique.swap(bigger);
+}
+
+BddManager::Node BddManager::make(int lv, Node lo, Node hi) {
+    if (lo == hi) return lo;
+
+    size_t mask = unique.size() - 1;
+    size_t slot = hashTriple(lv, lo, hi) & mask;
+    while (unique[slot] != -1) {
+        const NodeData& d = nodes[unique[slot]];
+        if (d.level == lv && d.lo == lo && d.hi == hi) return unique[slot];
+        slot = (slot + 1) & mask;
+    }
+
+    if (nodes.size() >= nodeLimit) throw length_error("BDD node limit reached");
+    Node n = static_cast<Node>(nodes.size());
+    nodes.push_back({lv, lo, hi});
+    unique[slot] = n;
+    if (nodes.size() * 2 > unique.size()) growUnique();
+    return n;
+}
+
+BddManager::Node BddManager::apply(int op, Node a, Node b) {
+    // Terminal cases
+    if (op == OP_NOT) {
+        if (a == FALSE_NODE) return TRUE_NODE;
+        if (a == TRUE_NODE) return FALSE_NODE;
+    } else if (op == OP_AND) {
+        if (a == FALSE_NODE || b == FALSE_NODE) return FALSE_NODE;
+        if (a == TRUE_NODE) return b;
+        if (b == TRUE_NODE || a == b) return a;
+    } else {
+        if (a == TRUE_NODE || b == TRUE_NODE) return TRUE_NODE;
+        if (a == FALSE_NODE) return b;
+        if (b == FALSE_NODE || a == b) return a;
+    }
+    if (op != OP_NOT && a > b) swap(a, b);
+
+    CacheEntry& entry = cache[hashTriple(op, a, b) & (cache.size() - 1)];
+    if (entry.op == op && entry.a == a && entry.b == b) return entry.result;
+
+    int lv = op == OP_NOT ? level(a) : min(level(a), level(b));
+    Node lo = apply(op, low(a, lv), op == OP_NOT ? b : low(b, lv));
+    Node hi = apply(op, high(a, lv), op == OP_NOT ? b : high(b, lv));
+    Node result = make(lv, lo, hi);
+
+    // The recursion may have reused this slot
+    CacheEntry& slot = cache[hashTriple(op, a, b) & (cache.size() - 1)];
+    slot.op = op;
+    slot.a = a;
+    slot.b = b;
+    slot.result = result;
+    return result;
+}
+
+BddManager::Node BddManager::bddAnd(Node a, Node b) { return apply(OP_AND, a, b); }
+BddManager::Node BddManager::bddOr(Node a, Node b) { return apply(OP_OR, a, b); }
+BddManager::Node BddManager::bddNot(Node a) { return apply(OP_NOT, a, FALSE_NODE); }
+
+BddManager::Node BddManager::cube(const Cube& c) {
+    Node f = TRUE_NODE;
+    for (int lv = numVars - 1; lv >= 0; lv--) {
+        char lit = c.literal(order[lv]);
+        if (lit == '0') f = make(lv, f, FALSE_NODE);
+        else if (lit == '1') f = make(lv, FALSE_NODE, f);
+    }
+    return f;
+}
+
+// Balanced OR keeps the intermediate BDDs small
+BddManager::Node BddManager::coverRange(const vector<Cube>& F, size_t begin, size_t end) {
+    if (begin == end) return FALSE_NODE;
+    if (end - begin == 1) return cube(F[begin]);
+    size_t mid = begin + (end - begin) / 2;
+    return bddOr(coverRange(F, begin, mid), coverRange(F, mid, end));
+}
+
+BddManager::Node BddManager::cover(const vector<Cube>& F) {
+    return coverRange(F, 0, F.size());
+}
+
+// Cubes that must have x = 0 come from the part of lower that upper rules out
+// for x = 1, and likewise for x = 1; whatever is left of lower is covered by
+// cubes independent of x.
+const BddManager::IsopResult& BddManager::isopRec(Node lower, Node upper) {
+    static const IsopResult empty = {FALSE_NODE, {}};
+    static const IsopResult universe = {TRUE_NODE, {Cube()}};
+    if (lower == FALSE_NODE) return empty;
+    if (upper == TRUE_NODE) return universe;
+
+    uint64_t key = (static_cast<uint64_t>(lower) << 32) | static_cast<uint32_t>(upper);
+    auto found = isopMemo.find(key);
+    if (found != isopMemo.end()) return found->second;
+
+    int lv = min(level(lower), level(upper));
+    Node l0 = low(lower, lv), l1 = high(lower, lv);
+    Node u0 = low(upper, lv), u1 = high(upper, lv);
+
+    const IsopResult& r0 = isopRec(bddAnd(l0, bddNot(u1)), u0);
+    const IsopResult& r1 = isopRec(bddAnd(l1, bddNot(u0)), u1);
+    Node rest = bddOr(bddAnd(l0, bddNot(r0.f)), bddAnd(l1, bddNot(r1.f)));
+    const IsopResult& rd = isopRec(rest, bddAnd(u0, u1));
+
+    IsopResult result;
+    result.f = bddOr(make(lv, r0.f, r1.f), rd.f);
+    result.cubes.reserve(r0.cubes.size() + r1.cubes.size() + rd.cubes.size());
+    int var = order[lv];
+    for (Cube c : r0.cubes) {
+        c.setLiteral(var, '0');
+        result.cubes.push_back(c);
+    }
+    for (Cube c : r1.cubes) {
+        c.setLiteral(var, '1');
+        result.cubes.push_back(c);
+    }
+    result.cubes.insert(result.cubes.end(), rd.cubes.begin(), rd.cubes.end());
+    return isopMemo.emplace(key, move(result)).first->second;
+}
+
+vector<Cube> BddManager::isop(Node lower, Node upper) {
+    return isopRec(lower, upper).cubes;
+}
+
+vector<int> bddVariableOrder(const vector<Cube>& F, int numVars) {
+    vector<int> uses(numVars, 0);
+    for (const Cube& c : F) {
+        for (int j = 0; j < numVars; j++) {
+            if (c.literal(j) != '-') uses[j]++;
+        }
+    }
+    vector<int> order(numVars);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return uses[a] > uses[b]; });
+    return order;
+}
+
+vector<Term> runBddMinimize(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars,
+                            const BddOptions& options) {
+    if (onSet.empty()) return {};
+    QELM_PROFILE_SCOPE(Bdd);
+
+    vector<Cube> on, dc;
+    for (const Term& t : onSet) on.push_back(t.getCube());
+    for (const Term& t : dcSet) dc.push_back(t.getCube());
+
+    vector<Cube> all = on;
+    all.insert(all.end(), dc.begin(), dc.end());
+    BddManager bdd(numVars, bddVariableOrder(all, numVars), options.nodeLimit, options.cacheSize);
+
+    BddManager::Node lower = bdd.cover(on);
+    BddManager::Node upper = bdd.bddOr(lower, bdd.cover(dc));
+    vector<Cube> F = bdd.isop(lower, upper);
+
+    // Raise each cube to a prime: drop literals while the cube stays inside on + dc.
+    // The input cubes are raised too; their primes tend to be the larger ones,
+    // and irredundant keeps whichever candidates it needs.
+    auto raise = [&](const vector<Cube>& cubes) {
+        vector<Term> primes;
+        for (Cube c : cubes) {
+            for (int j = 0; j < numVars; j++) {
+                if (c.literal(j) == '-') continue;
+                Cube raised = c;
+                raised.setLiteral(j, '-');
+                if (bdd.implies(bdd.cube(raised), upper)) c = raised;
+            }
+            primes.push_back(Term(c, numVars));
+        }
+        sort(primes.begin(), primes.end());
+        primes.erase(unique(primes.begin(), primes.end()), primes.end());
+        return primes;
+    };
+
+    F.insert(F.end(), on.begin(), on.end());
+    vector<Term> cover = irredundant(raise(F), dcSet, numVars);
+
+    // Espresso's improvement loop, with the BDD of on + dc standing in for the
+    // OFF-set when raising, so the complement is never built
+    pair<size_t, int> cost = {cover.size(), countLiterals(cover)};
+    while (true) {
+        vector<Cube> reduced;
+        for (const Term& t : reduce(cover, dcSet, numVars)) reduced.push_back(t.getCube());
+        vector<Term> next = irredundant(raise(reduced), dcSet, numVars);
+
+        pair<size_t, int> nextCost = {next.size(), countLiterals(next)};
+        if (nextCost >= cost) break;
+        cover = next;
+        cost = nextCost;
+    }
+    return cover;
+}
@@ -0,0 +1,223 @@
+#include "cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const char MAGIC[8] = {'Q', 'E', 'L', 'M', 'C', 'C', '1', '\n'};
+
+// splitmix64 finalizer
+static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+string CacheKey::hex() const {
+    char text[33];
+    snprintf(text, sizeof(text), "%016llx%016llx", static_cast<unsigned long long>(high),
+             static_cast<unsigned long long>(low));
+    return text;
+}
+
+// Two lanes with different constants, so a collision needs both 64-bit halves to collide
+void CacheKeyBuilder::addWord(uint64_t word) {
+    current.high = mix(current.high ^ (word + 0x9e3779b97f4a7c15ULL));
+    current.low = mix((current.low + 0x632be59bd9b4e019ULL) ^ word) + word;
+}
+
+static vector<Cube> canonical(const vector<Term>& terms) {
+    vector<Cube> cubes;
+    cubes.reserve(terms.size());
+    for (const Term& t : terms) cubes.push_back(t.getCube());
+    sort(cubes.begin(), cubes.end());
+    cubes.erase(unique(cubes.begin(), cubes.end()), cubes.end());
+    return cubes;
+}
+
+void CacheKeyBuilder::addFunction(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars) {
+    addWord(static_cast<uint64_t>(numVars));
+    for (const vector<Term>* set : {&onSet, &dcSet}) {
+        vector<Cube> cubes = canonical(*set);
+        addWord(cubes.size());
+        for (const Cube& c : cubes) {
+            for (int w = 0; w < Cube::WORDS; w++) {
+                addWord(c.value[w]);
+                addWord(c.care[w]);
+            }
+        }
+    }
+}
+
+void CacheKeyBuilder::addTag(const string& tag) {
+    addWord(tag.size());
+    for (char ch : tag) addWord(static_cast<unsigned char>(ch));
+}
+
+ResultCache::ResultCache(const string& directory, uint64_t maxBytes) : directory(directory), maxBytes(maxBytes) {
+    error_code ec;
+    fs::create_directories(directory, ec);
+}
+
+static string entryPath(const string& directory, const CacheKey& key) {
+    return (fs::path(directory) / (key.hex() + ".qc")).string();
+}
+
+// Reads from an entry's bytes; a read past the end clears ok
+class EntryReader {
+public:
+    explicit EntryReader(const vector<char>& bytes) : p(bytes.data()), end(bytes.data() + bytes.size()) {}
+
+    void read(void* out, size_t length) {
+        if (static_cast<size_t>(end - p) < length) {
+            ok = false;
+            return;
+        }
+        memcpy(out, p, length);
+        p += length;
+    }
+    size_t left() const { return static_cast<size_t>(end - p); }
+
+    bool ok = true;
+
+private:
+    const char* p;
+    const char* end;
+};
+
+// Parses an entry; false if it is damaged or not for numVars
+static bool readEntry(const vector<char>& bytes, int numVars, vector<CachedCover>& outputs) {
+    EntryReader in(bytes);
+    char magic[sizeof(MAGIC)];
+    uint32_t vars = 0, count = 0;
+    in.read(magic, sizeof(magic));
+    in.read(&vars, sizeof(vars));
+    in.read(&count, sizeof(count));
+    if (!in.ok || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || vars != static_cast<uint32_t>(numVars)) return false;
+
+    // Counts are checked against the bytes present before anything is allocated
+    const size_t OUTPUT_HEADER = 2 + sizeof(uint32_t);
+    size_t words = (numVars + 63) / 64;
+    size_t cubeBytes = 2 * words * sizeof(uint64_t);
+    if (count > in.left() / OUTPUT_HEADER) return false;
+    vector<CachedCover> read(count);
+    for (CachedCover& out : read) {
+        uint32_t cubes = 0;
+        in.read(&out.engine, 1);
+        in.read(&out.flags, 1);
+        in.read(&cubes, sizeof(cubes));
+        // With no variables a cube takes no bytes, so only an empty cover fits
+        if (!in.ok || (cubeBytes == 0 ? cubes > 0 : cubes > in.left() / cubeBytes)) return false;
+        out.cover.reserve(cubes);
+        for (uint32_t i = 0; i < cubes; i++) {
+            Cube c;
+            in.read(c.value, words * sizeof(uint64_t));
+            in.read(c.care, words * sizeof(uint64_t));
+            // Value bits must stay inside the care bits for cube equality to work
+            for (size_t w = 0; w < words; w++) {
+                if (c.value[w] & ~c.care[w]) return false;
+            }
+            out.cover.push_back(Term(c, numVars));
+        }
+    }
+    if (!in.ok || in.left() != 0) return false;
+    outputs.swap(read);
+    return true;
+}
+
+bool ResultCache::lookup(const CacheKey& key, int numVars, vector<CachedCover>& outputs) const {
+    string path = entryPath(directory, key);
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    vector<char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+
+    // A damaged entry is a miss, and goes so the next store can replace it
+    error_code ec;
+    if (!readEntry(bytes, numVars, outputs)) {
+        fs::remove(path, ec);
+        return false;
+    }
+
+    // Recently used entries are the last to be evicted
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+void ResultCache::store(const CacheKey& key, int numVars, const vector<CachedCover>& outputs) {
+    string path = entryPath(directory, key);
+    // Unique per thread and process, so concurrent stores never share a temporary
+    string temp = path + "." + to_string(getpid()) + "." + to_string(hash<thread::id>()(this_thread::get_id())) + ".tmp";
+    {
+        ofstream out(temp, ios::binary | ios::trunc);
+        if (!out) return;
+        uint32_t vars = static_cast<uint32_t>(numVars);
+        uint32_t count = static_cast<uint32_t>(outputs.size());
+        out.write(MAGIC, sizeof(MAGIC));
+        out.write(reinterpret_cast<const char*>(&vars), sizeof(vars));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+        int words = (numVars + 63) / 64;
+        for (const CachedCover& c : outputs) {
+            uint32_t cubes = static_cast<uint32_t>(c.cover.size());
+            out.write(reinterpret_cast<const char*>(&c.engine), 1);
+            out.write(reinterpret_cast<const char*>(&c.flags), 1);
+            out.write(reinterpret_cast<const char*>(&cubes), sizeof(cubes));
+            for (const Term& t : c.cover) {
+                out.write(reinterpret_cast<const char*>(t.getCube().value), words * sizeof(uint64_t));
+                out.write(reinterpret_cast<const char*>(t.getCube().care), words * sizeof(uint64_t));
+            }
+        }
+        if (!out) {
+            out.close();
+            remove(temp.c_str());
+            return;
+        }
+    }
+
+    error_code ec;
+    uint64_t size = fs::file_size(temp, ec);
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return;
+    }
+    if (bytesSinceScan.fetch_add(size) + size > maxBytes / 4) evict();
+}
+
+void ResultCache::evict() {
+    lock_guard<mutex> lock(evictLock);
+    bytesSinceScan = 0;
+
+    struct Entry {
+        fs::path path;
+        fs::file_time_type time;
+        uint64_t size;
+    };
+    vector<Entry> entries;
+    uint64_t total = 0;
+    error_code ec;
+    for (const fs::directory_entry& e : fs::directory_iterator(directory, ec)) {
+        if (e.path().extension() != ".qc") continue;
+        Entry entry{e.path(), e.last_write_time(ec), e.file_size(ec)};
+        if (ec) continue;
+        total += entry.size;
+        entries.push_back(entry);
+    }
+    if (total <= maxBytes) return;
+
+    // Oldest first, down to three quarters of the limit so the next few stores do not evict again
+    sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    for (const Entry& e : entries) {
+        if (total <= maxBytes / 4 * 3) break;
+        if (fs::remove(e.path, ec)) total -= e.size;
+    }
+}
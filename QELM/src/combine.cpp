@@ -1,50 +1,161 @@
 #include "term.hpp"
 #include "combine.hpp"
-#include "utils.hpp"
+#include "arena.hpp"
+#include "profile.hpp"
 #include <vector>
-#include <map>
-#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
-vector<Term> combineTerms(const vector<Term>& terms) {
-    map<int, vector<Term>> groups = groupByOnes(terms);
-    set<Term> combinedSet;
-    vector<Term> primeImplicants;
-    
-
-    // Loop through adjacent groups
-    for (auto it = groups.begin(); next(it) != groups.end(); it++) {
-        const vector<Term>& groupA = it->second;
-        const vector<Term>& groupB = next(it)->second;
-
-        for (const Term& termA : groupA) {
-            for (const Term& termB : groupB) {
-                if (termA.canCombineWith(termB)) {
-                    Term combined = termA.combineWith(termB);
-                    combinedSet.insert(combined);
-                    const_cast<Term&>(termA).markUsed();//not safe
-                    const_cast<Term&>(termB).markUsed();
-                }
+// Terms that share a don't-care mask, indexed by their value bits.
+// Two terms can only combine when they sit in the same bucket and their
+// values differ in exactly one bit, so a partner is found by flipping that
+// bit and hashing instead of scanning the whole next ones-group.
+struct CareBucket {
+    pmr::unordered_map<Cube, size_t, CubeHash> byValue;
+
+    explicit CareBucket(pmr::memory_resource* memory) : byValue(memory) {}
+};
+
+// Below this many terms a round is cheaper than starting threads
+static const size_t PARALLEL_MIN_TERMS = 4096;
+
+// Output of one worker: its own used flags and merged terms, so workers never
+// write to shared state and no term has to be marked through a const reference
+struct CombineSlice {
+    vector<char> used;
+    vector<Term> combined;
+    size_t lookups = 0;     // partner lookups, for the profile
+};
+
+// Merge every term of ones-group k with its partners in group k + 1.
+// Only the side with the flipped bit at 0 looks up the side with it at 1,
+// so each pair is examined once. The same cube can still come from pairs in
+// different care buckets (0-- from 00- + 01- and from 0-0 + 0-1); the caller
+// removes those duplicates.
+// Stops early, leaving the slice partial, when cancel fires.
+static void combineGroup(const pmr::vector<Term>& unique, const vector<const CareBucket*>& bucketOf,
+                         const vector<size_t>& group, CombineSlice& slice, const CancelToken* cancel) {
+    for (size_t n = 0; n < group.size(); n++) {
+        if ((n & 1023) == 1023 && cancelRequested(cancel)) return;
+        size_t i = group[n];
+        const Cube& cube = unique[i].getCube();
+        const CareBucket& bucket = *bucketOf[i];
+
+        for (int w = 0; w < Cube::WORDS; w++) {
+            uint64_t zeros = cube.care[w] & ~cube.value[w];
+            while (zeros) {
+                uint64_t bit = zeros & (~zeros + 1);
+                zeros ^= bit;
+
+                Cube partner = cube;
+                partner.value[w] |= bit;
+                slice.lookups++;
+                auto found = bucket.byValue.find(partner);
+                if (found == bucket.byValue.end()) continue;
+
+                size_t j = found->second;
+                slice.combined.push_back(unique[i].combineWith(unique[j]));
+                slice.used[i] = 1;
+                slice.used[j] = 1;
             }
         }
     }
-    
-    
-
-    // Add uncombined terms (prime implicants)
-    for (const auto& group : groups) {
-        for (const Term& term : group.second) {
-            if (!term.isUsed()) {
-                primeImplicants.push_back(term);
-            }
+}
+
+vector<Term> combineTerms(const vector<Term>& terms, int numThreads, const CancelToken* cancel) {
+    QELM_PROFILE_SCOPE(Combine);
+    QELM_PROFILE_ADD(SetInsertions, terms.size());
+
+    // Round-local tables come from the scratch arena of the calling thread;
+    // workers only read them
+    pmr::memory_resource* memory = scratchResource();
+    pmr::vector<Term> unique(memory);
+    unique.reserve(terms.size());
+    pmr::vector<CareBucket> buckets(memory);
+    pmr::unordered_map<Cube, size_t, CubeHash> bucketIndex(memory);
+
+    // Bucket by care mask, dropping repeated cubes
+    for (const Term& t : terms) {
+        Cube careKey;
+        for (int w = 0; w < Cube::WORDS; w++) careKey.care[w] = t.getCube().care[w];
+
+        auto slot = bucketIndex.emplace(careKey, buckets.size());
+        if (slot.second) buckets.emplace_back(memory);
+        CareBucket& bucket = buckets[slot.first->second];
+        if (bucket.byValue.emplace(t.getCube(), unique.size()).second) {
+            unique.push_back(t);
         }
     }
 
-    // Add combined terms to result
-    for (const Term& t : combinedSet) {
-        primeImplicants.push_back(t);
+    // Buckets are not touched again, so these pointers stay valid
+    vector<const CareBucket*> bucketOf(unique.size());
+    for (const CareBucket& bucket : buckets) {
+        for (const auto& [cube, i] : bucket.byValue) {
+            bucketOf[i] = &bucket;
+        }
     }
 
+    vector<vector<size_t>> byOnes;
+    for (size_t i = 0; i < unique.size(); i++) {
+        size_t ones = static_cast<size_t>(unique[i].countOnes());
+        if (ones >= byOnes.size()) byOnes.resize(ones + 1);
+        byOnes[ones].push_back(i);
+    }
+
+    // Each (k, k + 1) pair of groups is independent; workers pull groups off a shared counter
+    if (numThreads <= 0) numThreads = static_cast<int>(max(1u, thread::hardware_concurrency()));
+    if (unique.size() < PARALLEL_MIN_TERMS) numThreads = 1;
+    numThreads = static_cast<int>(min<size_t>(numThreads, max<size_t>(byOnes.size(), 1)));
+
+    vector<CombineSlice> slices(numThreads);
+    atomic<size_t> nextGroup(0);
+    auto worker = [&](CombineSlice& slice) {
+        slice.used.assign(unique.size(), 0);
+        for (size_t k = nextGroup++; k < byOnes.size() && !cancelRequested(cancel); k = nextGroup++) {
+            combineGroup(unique, bucketOf, byOnes[k], slice, cancel);
+        }
+    };
+
+    if (numThreads == 1) {
+        worker(slices[0]);
+    } else {
+        vector<thread> pool;
+        for (int t = 0; t < numThreads; t++) {
+            pool.emplace_back(worker, ref(slices[t]));
+        }
+        for (thread& th : pool) th.join();
+    }
+
+    // A partial round is dropped: the caller gets its terms back
+    if (cancelRequested(cancel)) return terms;
+
+    // Merge the slices; sorting makes the result independent of thread scheduling
+    vector<char> used(unique.size(), 0);
+    vector<Term> combined;
+    for (CombineSlice& slice : slices) {
+        for (size_t i = 0; i < used.size(); i++) used[i] |= slice.used[i];
+        combined.insert(combined.end(), slice.combined.begin(), slice.combined.end());
+        QELM_PROFILE_ADD(MergesAttempted, slice.lookups);
+    }
+    QELM_PROFILE_ADD(MergesSucceeded, combined.size());
+    QELM_PROFILE_ADD(CubesGenerated, combined.size());
+
+    // Uncombined terms are prime implicants, kept in input order
+    vector<Term> primeImplicants;
+    for (size_t i = 0; i < unique.size(); i++) {
+        if (!used[i]) {
+            primeImplicants.push_back(unique[i]);
+        }
+    }
+
+    // Combined terms follow in sorted order, once each, so the result does not depend on hashing
+    sort(combined.begin(), combined.end());
+    combined.erase(std::unique(combined.begin(), combined.end()), combined.end());
+    primeImplicants.insert(primeImplicants.end(), combined.begin(), combined.end());
+
     return primeImplicants;
 }
@@ -0,0 +1,274 @@
+#include "cover.hpp"
+#include "profile.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+using namespace std;
+
+// Live rows of the covering matrix, each a sorted list of column indices
+typedef vector<vector<int>> CoverMatrix;
+
+static void removeRowsWith(CoverMatrix& rows, int col) {
+    rows.erase(remove_if(rows.begin(), rows.end(), [col](const vector<int>& r) {
+        return binary_search(r.begin(), r.end(), col);
+    }), rows.end());
+}
+
+// Essential columns, row dominance and column dominance until nothing changes.
+// Returns false when some row can no longer be covered.
+static bool reduceMatrix(CoverMatrix& rows, const vector<long long>& costs,
+                         vector<int>& chosen, long long& cost) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        // A row with a single column forces that column
+        for (size_t r = 0; r < rows.size(); r++) {
+            if (rows[r].empty()) return false;
+            if (rows[r].size() == 1) {
+                int col = rows[r][0];
+                chosen.push_back(col);
+                cost += costs[col];
+                removeRowsWith(rows, col);
+                changed = true;
+                r = static_cast<size_t>(-1);
+            }
+        }
+        if (rows.empty()) return true;
+
+        // Row dominance: covering a row also covers every row that is a superset of it
+        sort(rows.begin(), rows.end(), [](const vector<int>& a, const vector<int>& b) {
+            return a.size() != b.size() ? a.size() < b.size() : a < b;
+        });
+        rows.erase(unique(rows.begin(), rows.end()), rows.end());
+        vector<char> deadRow(rows.size(), 0);
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (deadRow[i]) continue;
+            for (size_t j = i + 1; j < rows.size(); j++) {
+                if (!deadRow[j] && includes(rows[j].begin(), rows[j].end(), rows[i].begin(), rows[i].end())) {
+                    deadRow[j] = 1;
+                    changed = true;
+                }
+            }
+        }
+        CoverMatrix kept;
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (!deadRow[i]) kept.push_back(std::move(rows[i]));
+        }
+        rows = std::move(kept);
+
+        // Column dominance: drop a column whose rows are all covered by a no more expensive one
+        vector<int> cols;
+        for (const vector<int>& r : rows) cols.insert(cols.end(), r.begin(), r.end());
+        sort(cols.begin(), cols.end());
+        cols.erase(unique(cols.begin(), cols.end()), cols.end());
+
+        vector<vector<int>> rowsOf(cols.size());
+        for (size_t r = 0; r < rows.size(); r++) {
+            for (int c : rows[r]) {
+                rowsOf[lower_bound(cols.begin(), cols.end(), c) - cols.begin()].push_back(static_cast<int>(r));
+            }
+        }
+
+        // A dominator of a must cover a's first row, so only that row's columns are candidates
+        vector<char> deadCol(cols.size(), 0);
+        for (size_t a = 0; a < cols.size(); a++) {
+            for (int other : rows[rowsOf[a][0]]) {
+                if (deadCol[a]) break;
+                size_t b = lower_bound(cols.begin(), cols.end(), other) - cols.begin();
+                if (a == b || deadCol[b]) continue;
+                if (costs[cols[b]] > costs[cols[a]]) continue;
+                if (!includes(rowsOf[b].begin(), rowsOf[b].end(), rowsOf[a].begin(), rowsOf[a].end())) continue;
+                // Identical columns: keep the lower index
+                if (rowsOf[a] == rowsOf[b] && costs[cols[a]] == costs[cols[b]] && a < b) continue;
+                deadCol[a] = 1;
+                changed = true;
+            }
+        }
+        for (vector<int>& r : rows) {
+            r.erase(remove_if(r.begin(), r.end(), [&](int c) {
+                return deadCol[lower_bound(cols.begin(), cols.end(), c) - cols.begin()];
+            }), r.end());
+        }
+    }
+    return true;
+}
+
+// Cost of a set of pairwise column-disjoint rows: each needs its own column
+static long long lowerBound(const CoverMatrix& rows, const vector<long long>& costs) {
+    vector<size_t> order(rows.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rows[a].size() < rows[b].size(); });
+
+    vector<char> taken(costs.size(), 0);
+    long long bound = 0;
+    for (size_t r : order) {
+        bool independent = true;
+        long long cheapest = LLONG_MAX;
+        for (int c : rows[r]) {
+            if (taken[c]) {
+                independent = false;
+                break;
+            }
+            cheapest = min(cheapest, costs[c]);
+        }
+        if (!independent) continue;
+        for (int c : rows[r]) taken[c] = 1;
+        bound += cheapest;
+    }
+    return bound;
+}
+
+// Repeatedly take the column with the most rows per unit cost, then drop picks
+// that later picks made redundant
+static vector<int> greedyCover(CoverMatrix rows, const vector<long long>& costs) {
+    vector<int> picked;
+    const CoverMatrix all = rows;
+
+    while (!rows.empty()) {
+        vector<int> hits(costs.size(), 0);
+        for (const vector<int>& r : rows) {
+            for (int c : r) hits[c]++;
+        }
+        int bestCol = -1;
+        for (int c = 0; c < static_cast<int>(costs.size()); c++) {
+            if (!hits[c]) continue;
+            // hits[c] / costs[c] > hits[best] / costs[best], without division
+            if (bestCol < 0 || (long double)hits[c] * costs[bestCol] > (long double)hits[bestCol] * costs[c]) {
+                bestCol = c;
+            }
+        }
+        picked.push_back(bestCol);
+        removeRowsWith(rows, bestCol);
+    }
+
+    for (size_t i = picked.size(); i-- > 0; ) {
+        bool redundant = true;
+        for (const vector<int>& r : all) {
+            bool coveredByOthers = false;
+            for (size_t j = 0; j < picked.size() && !coveredByOthers; j++) {
+                coveredByOthers = j != i && binary_search(r.begin(), r.end(), picked[j]);
+            }
+            if (!coveredByOthers) {
+                redundant = false;
+                break;
+            }
+        }
+        if (redundant) picked.erase(picked.begin() + i);
+    }
+    return picked;
+}
+
+struct CoverSearch {
+    const vector<long long>& costs;
+    const CoverOptions& options;
+    chrono::steady_clock::time_point start;
+
+    vector<int> best;
+    long long bestCost = LLONG_MAX;
+    size_t nodes = 0;
+    bool stopped = false;
+
+    CoverSearch(const vector<long long>& costs, const CoverOptions& options)
+        : costs(costs), options(options), start(chrono::steady_clock::now()) {}
+
+    bool outOfBudget() {
+        if (options.nodeLimit && nodes >= options.nodeLimit) return true;
+        if ((nodes & 63) != 0) return false;
+        if (cancelRequested(options.cancel)) return true;
+        if (options.timeLimitSeconds > 0) {
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            return elapsed.count() >= options.timeLimitSeconds;
+        }
+        return false;
+    }
+
+    void search(CoverMatrix rows, vector<int> chosen, long long cost) {
+        if (stopped || outOfBudget()) {
+            stopped = true;
+            return;
+        }
+        nodes++;
+
+        if (!reduceMatrix(rows, costs, chosen, cost)) return;
+        if (rows.empty()) {
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = chosen;
+            }
+            return;
+        }
+        if (cost + lowerBound(rows, costs) >= bestCost) return;
+
+        // Branch on the hardest row: one of its columns must be in the cover
+        size_t pivot = 0;
+        for (size_t r = 1; r < rows.size(); r++) {
+            if (rows[r].size() < rows[pivot].size()) pivot = r;
+        }
+        vector<int> branchCols = rows[pivot];
+
+        vector<int> hits(costs.size(), 0);
+        for (const vector<int>& r : rows) {
+            for (int c : r) hits[c]++;
+        }
+        sort(branchCols.begin(), branchCols.end(), [&](int a, int b) {
+            return (long double)hits[a] * costs[b] > (long double)hits[b] * costs[a];
+        });
+
+        // Branches are disjoint: the k-th one excludes the columns tried before it
+        CoverMatrix remaining = rows;
+        for (int col : branchCols) {
+            CoverMatrix next = remaining;
+            removeRowsWith(next, col);
+
+            vector<int> nextChosen = chosen;
+            nextChosen.push_back(col);
+            search(std::move(next), std::move(nextChosen), cost + costs[col]);
+            if (stopped) return;
+
+            for (vector<int>& r : remaining) {
+                auto it = lower_bound(r.begin(), r.end(), col);
+                if (it != r.end() && *it == col) r.erase(it);
+            }
+        }
+    }
+};
+
+CoverResult solveCover(const vector<vector<int>>& rows, const vector<long long>& costs,
+                       const CoverOptions& options) {
+    QELM_PROFILE_SCOPE(CoverSearch);
+    CoverMatrix matrix;
+    for (const vector<int>& r : rows) {
+        if (r.empty()) continue;
+        vector<int> sorted = r;
+        sort(sorted.begin(), sorted.end());
+        sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+        matrix.push_back(std::move(sorted));
+    }
+
+    CoverResult result;
+    vector<int> chosen;
+    long long cost = 0;
+    reduceMatrix(matrix, costs, chosen, cost);
+
+    // The greedy cover is both the first upper bound and the fallback
+    CoverSearch searcher(costs, options);
+    searcher.best = chosen;
+    searcher.bestCost = cost;
+    for (int c : greedyCover(matrix, costs)) {
+        searcher.best.push_back(c);
+        searcher.bestCost += costs[c];
+    }
+
+    if (!matrix.empty()) {
+        searcher.search(matrix, chosen, cost);
+    }
+
+    result.columns = searcher.best;
+    sort(result.columns.begin(), result.columns.end());
+    result.cost = searcher.bestCost;
+    result.optimal = !searcher.stopped;
+    result.nodes = searcher.nodes;
+    return result;
+}
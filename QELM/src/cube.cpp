@@ -0,0 +1,60 @@
+#include "cube.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+Cube Cube::fromString(const string& bits) {
+    if (bits.size() > MAX_VARS) {
+        throw length_error("Error: cube wider than Cube::MAX_VARS variables");
+    }
+    Cube c;
+    for (size_t j = 0; j < bits.size(); j++) {
+        c.setLiteral(static_cast<int>(j), bits[j]);
+    }
+    return c;
+}
+
+uint64_t Cube::reverseBits(uint64_t x, int numVars) {
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = __builtin_bswap64(x);
+    return numVars == 0 ? 0 : x >> (64 - numVars);
+}
+
+// Decimal minterms keep the QM convention: variable 0 is the most significant bit
+Cube Cube::fromMinterm(int decimal, int numVars) {
+    Cube c;
+    c.care[0] = numVars >= 64 ? ~uint64_t(0) : (uint64_t(1) << numVars) - 1;
+    c.value[0] = reverseBits(static_cast<uint64_t>(decimal), numVars);
+    return c;
+}
+
+string Cube::toString(int numVars) const {
+    string s(numVars, '-');
+    for (int j = 0; j < numVars; j++) {
+        s[j] = literal(j);
+    }
+    return s;
+}
+
+void Cube::setLiteral(int var, char c) {
+    uint64_t bit = uint64_t(1) << (var & 63);
+    int w = var >> 6;
+    if (c == '0') {
+        care[w] |= bit;
+        value[w] &= ~bit;
+    } else if (c == '1') {
+        care[w] |= bit;
+        value[w] |= bit;
+    } else {
+        care[w] &= ~bit;
+        value[w] &= ~bit;
+    }
+}
+
+MintermRange::MintermRange(const Cube& cube, int numVars) {
+    uint64_t all = (uint64_t(1) << numVars) - 1;
+    base = static_cast<int>(Cube::reverseBits(cube.value[0], numVars));
+    freeMask = static_cast<int>(Cube::reverseBits(~cube.care[0] & all, numVars));
+}
@@ -0,0 +1,364 @@
+#include "cube_batch.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define QELM_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+CubeArray::CubeArray(int numVars) : numWords(numVars <= 0 ? 1 : (numVars + 63) / 64) {
+    if (numWords > Cube::WORDS) numWords = Cube::WORDS;
+}
+
+CubeArray::CubeArray(const vector<Cube>& cubes, int numVars) : CubeArray(numVars) {
+    for (int w = 0; w < numWords; w++) {
+        value[w].reserve(cubes.size());
+        care[w].reserve(cubes.size());
+    }
+    for (const Cube& c : cubes) push_back(c);
+}
+
+void CubeArray::push_back(const Cube& c) {
+    for (int w = 0; w < numWords; w++) {
+        value[w].push_back(c.value[w]);
+        care[w].push_back(c.care[w]);
+    }
+    count++;
+}
+
+void CubeArray::set(size_t i, const Cube& c) {
+    for (int w = 0; w < numWords; w++) {
+        value[w][i] = c.value[w];
+        care[w][i] = c.care[w];
+    }
+}
+
+void CubeArray::clear() {
+    for (int w = 0; w < numWords; w++) {
+        value[w].clear();
+        care[w].clear();
+    }
+    count = 0;
+}
+
+// === Kernels ===
+// Each one tests c against candidates [first, first + n), n <= 64, and returns
+// their match bits. The per-word logic is the same in every version:
+//   intersects:  no word has (c.value ^ d.value) & c.care & d.care
+//   contained:   no word has c.care & (~d.care | (c.value ^ d.value))
+//   containing:  no word has d.care & (~c.care | (c.value ^ d.value))
+//   adjacent:    care words equal, and value XOR has exactly one bit in total
+
+enum MatchOp { OP_INTERSECTS, OP_CONTAINED, OP_CONTAINING, OP_ADJACENT };
+
+typedef uint64_t (*BlockKernel)(const Cube& c, const CubeArray& a, size_t first, size_t n);
+typedef void (*DistanceKernel)(const Cube& c, const CubeArray& a, size_t first, size_t n, uint64_t& one, uint64_t& two);
+
+template <int op>
+static bool matchOne(const Cube& c, const CubeArray& a, size_t i) {
+    int diffBits = 0;
+    for (int w = 0; w < a.words(); w++) {
+        uint64_t dv = a.values(w)[i], dc = a.cares(w)[i];
+        uint64_t diff = c.value[w] ^ dv;
+        if (op == OP_INTERSECTS && (diff & c.care[w] & dc)) return false;
+        if (op == OP_CONTAINED && (c.care[w] & (~dc | diff))) return false;
+        if (op == OP_CONTAINING && (dc & (~c.care[w] | diff))) return false;
+        if (op == OP_ADJACENT) {
+            if (c.care[w] != dc) return false;
+            diffBits += __builtin_popcountll(diff);
+        }
+    }
+    return op != OP_ADJACENT || diffBits == 1;
+}
+
+static int distanceOne(const Cube& c, const CubeArray& a, size_t i) {
+    int d = 0;
+    for (int w = 0; w < a.words(); w++) {
+        d += __builtin_popcountll((c.value[w] ^ a.values(w)[i]) & c.care[w] & a.cares(w)[i]);
+    }
+    return d;
+}
+
+static void distanceTail(const Cube& c, const CubeArray& a, size_t first, size_t from, size_t n,
+                         uint64_t& one, uint64_t& two) {
+    for (size_t i = from; i < n; i++) {
+        int d = distanceOne(c, a, first + i);
+        if (d == 1) one |= uint64_t(1) << i;
+        if (d == 2) two |= uint64_t(1) << i;
+    }
+}
+
+static void distanceScalar(const Cube& c, const CubeArray& a, size_t first, size_t n, uint64_t& one, uint64_t& two) {
+    one = two = 0;
+    distanceTail(c, a, first, 0, n, one, two);
+}
+
+template <int op>
+static uint64_t blockScalar(const Cube& c, const CubeArray& a, size_t first, size_t n) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (matchOne<op>(c, a, first + i)) bits |= uint64_t(1) << i;
+    }
+    return bits;
+}
+
+#ifdef QELM_X86_KERNELS
+
+template <int op>
+__attribute__((target("avx2"))) static uint64_t blockAvx2(const Cube& c, const CubeArray& a, size_t first, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    uint64_t bits = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i bad = zero, multi = zero, seen = zero;
+        for (int w = 0; w < a.words(); w++) {
+            __m256i cv = _mm256_set1_epi64x(static_cast<long long>(c.value[w]));
+            __m256i cc = _mm256_set1_epi64x(static_cast<long long>(c.care[w]));
+            __m256i dv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.values(w) + first + i));
+            __m256i dc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.cares(w) + first + i));
+            __m256i diff = _mm256_xor_si256(cv, dv);
+            if (op == OP_INTERSECTS) {
+                bad = _mm256_or_si256(bad, _mm256_and_si256(diff, _mm256_and_si256(cc, dc)));
+            } else if (op == OP_CONTAINED) {
+                // andnot(dc, cc) = cc & ~dc
+                bad = _mm256_or_si256(bad, _mm256_or_si256(_mm256_andnot_si256(dc, cc), _mm256_and_si256(cc, diff)));
+            } else if (op == OP_CONTAINING) {
+                bad = _mm256_or_si256(bad, _mm256_or_si256(_mm256_andnot_si256(cc, dc), _mm256_and_si256(dc, diff)));
+            } else {
+                bad = _mm256_or_si256(bad, _mm256_xor_si256(cc, dc));
+                // More than one bit in this word, or a bit here after one in an earlier word
+                __m256i nonzero = _mm256_andnot_si256(_mm256_cmpeq_epi64(diff, zero), _mm256_set1_epi64x(-1));
+                multi = _mm256_or_si256(multi, _mm256_and_si256(diff, _mm256_sub_epi64(diff, one)));
+                multi = _mm256_or_si256(multi, _mm256_and_si256(seen, nonzero));
+                seen = _mm256_or_si256(seen, nonzero);
+            }
+        }
+        __m256i ok = _mm256_cmpeq_epi64(_mm256_or_si256(bad, multi), zero);
+        if (op == OP_ADJACENT) ok = _mm256_and_si256(ok, seen);
+        uint64_t lanes = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(ok)));
+        bits |= lanes << i;
+    }
+    for (; i < n; i++) {
+        if (matchOne<op>(c, a, first + i)) bits |= uint64_t(1) << i;
+    }
+    return bits;
+}
+
+// Without a vector popcount, bits are counted up to three per word: x, x with
+// its lowest bit cleared, and that with its lowest bit cleared again are
+// nonzero for 1, 2 and 3+ bits. A total of 3 or more is all that matters.
+__attribute__((target("avx2"))) static void distanceAvx2(const Cube& c, const CubeArray& a, size_t first, size_t n,
+                                                          uint64_t& one, uint64_t& two) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi64x(1);
+    one = two = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        // cmpeq gives -1 per lane, so subtracting "is zero" and adding 1 per level counts the nonzero ones
+        __m256i count = zero;
+        for (int w = 0; w < a.words(); w++) {
+            __m256i cv = _mm256_set1_epi64x(static_cast<long long>(c.value[w]));
+            __m256i cc = _mm256_set1_epi64x(static_cast<long long>(c.care[w]));
+            __m256i dv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.values(w) + first + i));
+            __m256i dc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.cares(w) + first + i));
+            __m256i x = _mm256_and_si256(_mm256_xor_si256(cv, dv), _mm256_and_si256(cc, dc));
+            for (int level = 0; level < 3; level++) {
+                count = _mm256_add_epi64(count, _mm256_add_epi64(ones, _mm256_cmpeq_epi64(x, zero)));
+                x = _mm256_and_si256(x, _mm256_sub_epi64(x, ones));
+            }
+        }
+        __m256i isOne = _mm256_cmpeq_epi64(count, ones);
+        __m256i isTwo = _mm256_cmpeq_epi64(count, _mm256_set1_epi64x(2));
+        one |= static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(isOne)))) << i;
+        two |= static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(isTwo)))) << i;
+    }
+    distanceTail(c, a, first, i, n, one, two);
+}
+
+__attribute__((target("avx512f"))) static void distanceAvx512(const Cube& c, const CubeArray& a, size_t first, size_t n,
+                                                               uint64_t& one, uint64_t& two) {
+    const __m512i ones = _mm512_set1_epi64(1);
+    one = two = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i count = _mm512_setzero_si512();
+        for (int w = 0; w < a.words(); w++) {
+            __m512i cv = _mm512_set1_epi64(static_cast<long long>(c.value[w]));
+            __m512i cc = _mm512_set1_epi64(static_cast<long long>(c.care[w]));
+            __m512i dv = _mm512_loadu_si512(a.values(w) + first + i);
+            __m512i dc = _mm512_loadu_si512(a.cares(w) + first + i);
+            __m512i x = _mm512_ternarylogic_epi64(cc, dc, _mm512_xor_si512(cv, dv), 0x80);
+            for (int level = 0; level < 3; level++) {
+                count = _mm512_mask_add_epi64(count, _mm512_test_epi64_mask(x, x), count, ones);
+                x = _mm512_and_si512(x, _mm512_sub_epi64(x, ones));
+            }
+        }
+        one |= static_cast<uint64_t>(_mm512_cmpeq_epi64_mask(count, ones)) << i;
+        two |= static_cast<uint64_t>(_mm512_cmpeq_epi64_mask(count, _mm512_set1_epi64(2))) << i;
+    }
+    distanceTail(c, a, first, i, n, one, two);
+}
+
+template <int op>
+__attribute__((target("avx512f"))) static uint64_t blockAvx512(const Cube& c, const CubeArray& a, size_t first, size_t n) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi64(1);
+    uint64_t bits = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i bad = zero, multi = zero;
+        __mmask8 seen = 0, twice = 0;
+        for (int w = 0; w < a.words(); w++) {
+            __m512i cv = _mm512_set1_epi64(static_cast<long long>(c.value[w]));
+            __m512i cc = _mm512_set1_epi64(static_cast<long long>(c.care[w]));
+            __m512i dv = _mm512_loadu_si512(a.values(w) + first + i);
+            __m512i dc = _mm512_loadu_si512(a.cares(w) + first + i);
+            __m512i diff = _mm512_xor_si512(cv, dv);
+            // Ternary logic takes the three-input expressions in one instruction;
+            // the immediate is their truth table over (cc, dc, diff)
+            if (op == OP_INTERSECTS) {
+                bad = _mm512_or_si512(bad, _mm512_ternarylogic_epi64(cc, dc, diff, 0x80));      // cc & dc & diff
+            } else if (op == OP_CONTAINED) {
+                bad = _mm512_or_si512(bad, _mm512_ternarylogic_epi64(cc, dc, diff, 0xb0));      // cc & (~dc | diff)
+            } else if (op == OP_CONTAINING) {
+                bad = _mm512_or_si512(bad, _mm512_ternarylogic_epi64(cc, dc, diff, 0x8c));      // dc & (~cc | diff)
+            } else {
+                bad = _mm512_or_si512(bad, _mm512_xor_si512(cc, dc));
+                __mmask8 nonzero = _mm512_test_epi64_mask(diff, diff);
+                multi = _mm512_or_si512(multi, _mm512_and_si512(diff, _mm512_sub_epi64(diff, one)));
+                twice |= seen & nonzero;
+                seen |= nonzero;
+            }
+        }
+        __m512i fail = _mm512_or_si512(bad, multi);
+        __mmask8 ok = _mm512_testn_epi64_mask(fail, fail);
+        if (op == OP_ADJACENT) ok &= seen & ~twice;
+        bits |= static_cast<uint64_t>(ok) << i;
+    }
+    for (; i < n; i++) {
+        if (matchOne<op>(c, a, first + i)) bits |= uint64_t(1) << i;
+    }
+    return bits;
+}
+
+#endif
+
+// === Dispatch ===
+
+struct KernelSet {
+    BlockKernel intersects, contained, containing, adjacent;
+    DistanceKernel distance;
+};
+
+static const KernelSet& kernelsFor(CubeKernel kernel) {
+    static const KernelSet scalar = {blockScalar<OP_INTERSECTS>, blockScalar<OP_CONTAINED>,
+                                     blockScalar<OP_CONTAINING>, blockScalar<OP_ADJACENT>, distanceScalar};
+#ifdef QELM_X86_KERNELS
+    static const KernelSet avx512 = {blockAvx512<OP_INTERSECTS>, blockAvx512<OP_CONTAINED>,
+                                     blockAvx512<OP_CONTAINING>, blockAvx512<OP_ADJACENT>, distanceAvx512};
+    static const KernelSet avx2 = {blockAvx2<OP_INTERSECTS>, blockAvx2<OP_CONTAINED>,
+                                   blockAvx2<OP_CONTAINING>, blockAvx2<OP_ADJACENT>, distanceAvx2};
+    if (kernel == CubeKernel::Avx512) return avx512;
+    if (kernel == CubeKernel::Avx2) return avx2;
+#endif
+    (void)kernel;
+    return scalar;
+}
+
+static bool supported(CubeKernel kernel) {
+#ifdef QELM_X86_KERNELS
+    if (kernel == CubeKernel::Avx512) return __builtin_cpu_supports("avx512f");
+    if (kernel == CubeKernel::Avx2) return __builtin_cpu_supports("avx2");
+#endif
+    return kernel == CubeKernel::Scalar;
+}
+
+static CubeKernel detectKernel() {
+#ifdef QELM_X86_KERNELS
+    // May run before libgcc has filled in the CPU model during static initialization
+    __builtin_cpu_init();
+#endif
+    for (CubeKernel k : {CubeKernel::Avx512, CubeKernel::Avx2}) {
+        if (supported(k)) return k;
+    }
+    return CubeKernel::Scalar;
+}
+
+// Detected on first use; setCubeKernel may change it while workers match
+static atomic<CubeKernel>& activeKernel() {
+    static atomic<CubeKernel> kernel(detectKernel());
+    return kernel;
+}
+
+static const KernelSet& active() {
+    return kernelsFor(activeKernel().load(memory_order_relaxed));
+}
+
+const char* cubeKernelName(CubeKernel kernel) {
+    switch (kernel) {
+        case CubeKernel::Scalar: return "scalar";
+        case CubeKernel::Avx2: return "avx2";
+        case CubeKernel::Avx512: return "avx512";
+    }
+    return "scalar";
+}
+
+CubeKernel cubeKernel() {
+    return activeKernel().load(memory_order_relaxed);
+}
+
+bool setCubeKernel(CubeKernel kernel) {
+    if (!supported(kernel)) return false;
+    activeKernel().store(kernel, memory_order_relaxed);
+    return true;
+}
+
+static void runBlocks(BlockKernel kernel, const Cube& c, const CubeArray& candidates, MatchMask& mask) {
+    size_t n = candidates.size();
+    mask.assign((n + 63) / 64, 0);
+    for (size_t b = 0; b < mask.size(); b++) {
+        size_t first = b * 64;
+        mask[b] = kernel(c, candidates, first, min<size_t>(64, n - first));
+    }
+}
+
+void matchIntersects(const Cube& c, const CubeArray& candidates, MatchMask& mask) {
+    runBlocks(active().intersects, c, candidates, mask);
+}
+
+void matchContainedIn(const Cube& c, const CubeArray& candidates, MatchMask& mask) {
+    runBlocks(active().contained, c, candidates, mask);
+}
+
+void matchContaining(const Cube& c, const CubeArray& candidates, MatchMask& mask) {
+    runBlocks(active().containing, c, candidates, mask);
+}
+
+void matchAdjacent(const Cube& c, const CubeArray& candidates, MatchMask& mask) {
+    runBlocks(active().adjacent, c, candidates, mask);
+}
+
+void matchDistance(const Cube& c, const CubeArray& candidates, MatchMask& one, MatchMask& two) {
+    DistanceKernel distance = active().distance;
+    size_t n = candidates.size();
+    one.assign((n + 63) / 64, 0);
+    two.assign(one.size(), 0);
+    for (size_t b = 0; b < one.size(); b++) {
+        size_t first = b * 64;
+        distance(c, candidates, first, min<size_t>(64, n - first), one[b], two[b]);
+    }
+}
+
+bool anyIntersects(const Cube& c, const CubeArray& candidates) {
+    BlockKernel intersects = active().intersects;
+    size_t n = candidates.size();
+    for (size_t first = 0; first < n; first += 64) {
+        if (intersects(c, candidates, first, min<size_t>(64, n - first))) return true;
+    }
+    return false;
+}
@@ -0,0 +1,345 @@
+#include "cubeops.hpp"
+#include "arena.hpp"
+#include "cube_batch.hpp"
+#include "budget.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory_resource>
+
+using namespace std;
+
+// Covers built inside the recursions live in the run's scratch arena; only
+// the results handed back to callers are plain vectors
+typedef pmr::vector<Cube> CubeList;
+
+static CubeList toList(const vector<Cube>& F) {
+    return CubeList(F.begin(), F.end(), scratchResource());
+}
+
+template <class In, class Out>
+static void cofactorInto(const In& F, const Cube& c, Out& result) {
+    result.reserve(F.size());
+    for (const Cube& f : F) {
+        if (!f.intersects(c)) continue;
+        Cube g = f;
+        for (int w = 0; w < Cube::WORDS; w++) {
+            g.care[w] &= ~c.care[w];
+            g.value[w] &= ~c.care[w];
+        }
+        result.push_back(g);
+    }
+}
+
+vector<Cube> cofactor(const vector<Cube>& F, const Cube& c) {
+    vector<Cube> result;
+    cofactorInto(F, c, result);
+    return result;
+}
+
+static CubeList cofactor(const CubeList& F, const Cube& c) {
+    CubeList result(scratchResource());
+    cofactorInto(F, c, result);
+    return result;
+}
+
+// Pick the variable to split on: the most binate one, or the most used one
+// if F is unate. Returns -1 when no cube has a literal.
+static int splitVariable(const CubeList& F, int numVars) {
+    int zeros[Cube::MAX_VARS] = {0};
+    int ones[Cube::MAX_VARS] = {0};
+    for (const Cube& f : F) {
+        for (int w = 0; w < Cube::WORDS; w++) {
+            uint64_t bits = f.care[w];
+            while (bits) {
+                int b = __builtin_ctzll(bits);
+                bits &= bits - 1;
+                int var = w * 64 + b;
+                if ((f.value[w] >> b) & 1) ones[var]++;
+                else zeros[var]++;
+            }
+        }
+    }
+
+    int best = -1;
+    int bestBinate = -1, bestTotal = 0;
+    for (int j = 0; j < numVars; j++) {
+        int total = zeros[j] + ones[j];
+        if (total == 0) continue;
+        int binate = min(zeros[j], ones[j]) > 0 ? 1 : 0;
+        if (binate > bestBinate || (binate == bestBinate && total > bestTotal)) {
+            best = j;
+            bestBinate = binate;
+            bestTotal = total;
+        }
+    }
+    return best;
+}
+
+static Cube literalCube(int var, char value) {
+    Cube c;
+    c.setLiteral(var, value);
+    return c;
+}
+
+static CubeList complementList(const CubeList& F, int numVars, size_t maxCubes) {
+    CubeList result(scratchResource());
+    if (F.empty()) {
+        result.push_back(Cube());
+        return result;
+    }
+    for (const Cube& f : F) {
+        if (f.countLiterals() == 0) return result;
+    }
+
+    // De Morgan on a single cube: one cube per negated literal
+    if (F.size() == 1) {
+        for (int j = 0; j < numVars; j++) {
+            char lit = F[0].literal(j);
+            if (lit == '0') result.push_back(literalCube(j, '1'));
+            else if (lit == '1') result.push_back(literalCube(j, '0'));
+        }
+        return result;
+    }
+
+    int var = splitVariable(F, numVars);
+    Cube x0 = literalCube(var, '0');
+    Cube x1 = literalCube(var, '1');
+    CubeList c0 = complementList(cofactor(F, x0), numVars, maxCubes);
+    CubeList c1 = complementList(cofactor(F, x1), numVars, maxCubes);
+    if (maxCubes > 0 && c0.size() + c1.size() > maxCubes) throw MemoryBudgetExceeded("the complement");
+
+    // Cubes found on both sides do not depend on the split variable
+    sort(c0.begin(), c0.end());
+    sort(c1.begin(), c1.end());
+    size_t i = 0, k = 0;
+    while (i < c0.size() || k < c1.size()) {
+        if (k == c1.size() || (i < c0.size() && c0[i] < c1[k])) {
+            Cube c = c0[i++];
+            c.setLiteral(var, '0');
+            result.push_back(c);
+        } else if (i == c0.size() || c1[k] < c0[i]) {
+            Cube c = c1[k++];
+            c.setLiteral(var, '1');
+            result.push_back(c);
+        } else {
+            result.push_back(c0[i]);
+            i++;
+            k++;
+        }
+    }
+    return result;
+}
+
+vector<Cube> complement(const vector<Cube>& F, int numVars, size_t maxCubes) {
+    ArenaScope scope("complement");
+    CubeList result = complementList(toList(F), numVars, maxCubes);
+    return vector<Cube>(result.begin(), result.end());
+}
+
+static void widenTo(Cube& s, const Cube& c) {
+    for (int w = 0; w < Cube::WORDS; w++) {
+        uint64_t agree = ~(s.value[w] ^ c.value[w]);
+        s.care[w] &= c.care[w] & agree;
+        s.value[w] &= s.care[w];
+    }
+}
+
+Cube supercube(const vector<Cube>& F) {
+    Cube s = F[0];
+    for (size_t i = 1; i < F.size(); i++) widenTo(s, F[i]);
+    return s;
+}
+
+int distance(const Cube& a, const Cube& b) {
+    int d = 0;
+    for (int w = 0; w < Cube::WORDS; w++) {
+        d += __builtin_popcountll((a.value[w] ^ b.value[w]) & a.care[w] & b.care[w]);
+    }
+    return d;
+}
+
+bool consensus(const Cube& a, const Cube& b, Cube& result) {
+    if (distance(a, b) > 1) return false;
+    for (int w = 0; w < Cube::WORDS; w++) {
+        uint64_t clash = (a.value[w] ^ b.value[w]) & a.care[w] & b.care[w];
+        result.care[w] = (a.care[w] | b.care[w]) & ~clash;
+        result.value[w] = (a.value[w] | b.value[w]) & result.care[w];
+    }
+    return true;
+}
+
+// Removes cubes with a literal in a unate variable until every variable left is
+// binate. With x only ever positive, F(x=0) is contained in F(x=1), so F is a
+// tautology exactly when the cubes without x are. False when nothing is left.
+static bool unateReduce(CubeList& F) {
+    while (!F.empty()) {
+        uint64_t pos[Cube::WORDS] = {0, 0, 0, 0};
+        uint64_t neg[Cube::WORDS] = {0, 0, 0, 0};
+        for (const Cube& f : F) {
+            for (int w = 0; w < Cube::WORDS; w++) {
+                pos[w] |= f.care[w] & f.value[w];
+                neg[w] |= f.care[w] & ~f.value[w];
+            }
+        }
+        uint64_t unate[Cube::WORDS];
+        bool anyUnate = false;
+        for (int w = 0; w < Cube::WORDS; w++) {
+            unate[w] = pos[w] ^ neg[w];
+            anyUnate |= unate[w] != 0;
+        }
+        if (!anyUnate) return true;
+
+        F.erase(remove_if(F.begin(), F.end(), [&](const Cube& f) {
+            for (int w = 0; w < Cube::WORDS; w++) {
+                if (f.care[w] & unate[w]) return true;
+            }
+            return false;
+        }), F.end());
+    }
+    return false;
+}
+
+// Fraction of the space F could cover at most; below 1 F cannot be a tautology
+static double volume(const CubeList& F) {
+    double v = 0;
+    for (const Cube& f : F) {
+        v += ldexp(1.0, -f.countLiterals());
+        if (v >= 1.0) break;
+    }
+    return v;
+}
+
+static bool tautology(CubeList F, int numVars) {
+    for (const Cube& f : F) {
+        if (f.countLiterals() == 0) return true;
+    }
+    if (volume(F) < 1.0) return false;
+    // A unate cover is a tautology only through a cube without literals
+    if (!unateReduce(F)) return false;
+
+    int var = splitVariable(F, numVars);
+    return tautology(cofactor(F, literalCube(var, '0')), numVars) &&
+           tautology(cofactor(F, literalCube(var, '1')), numVars);
+}
+
+bool isTautology(const vector<Cube>& F, int numVars) {
+    if (F.empty()) return false;
+    return tautology(toList(F), numVars);
+}
+
+static bool supercubeOfComplement(const CubeList& F, int numVars, Cube& result) {
+    result = Cube();
+    if (F.empty()) return true;
+    for (const Cube& f : F) {
+        if (f.countLiterals() == 0) return false;
+    }
+
+    // Complement of one cube is the union of its negated literals
+    if (F.size() == 1) {
+        if (F[0].countLiterals() == 1) {
+            for (int j = 0; j < numVars; j++) {
+                char lit = F[0].literal(j);
+                if (lit != '-') result.setLiteral(j, lit == '0' ? '1' : '0');
+            }
+        }
+        return true;
+    }
+
+    int var = splitVariable(F, numVars);
+    Cube s0, s1;
+    bool has0 = supercubeOfComplement(cofactor(F, literalCube(var, '0')), numVars, s0);
+    bool has1 = supercubeOfComplement(cofactor(F, literalCube(var, '1')), numVars, s1);
+    if (has0) s0.setLiteral(var, '0');
+    if (has1) s1.setLiteral(var, '1');
+    if (has0 && has1) {
+        result = s0;
+        widenTo(result, s1);
+    } else if (has0) {
+        result = s0;
+    } else if (has1) {
+        result = s1;
+    }
+    return has0 || has1;
+}
+
+bool supercubeOfComplement(const vector<Cube>& F, int numVars, Cube& result) {
+    return supercubeOfComplement(toList(F), numVars, result);
+}
+
+bool coversCube(const vector<Cube>& F, const Cube& c, int numVars) {
+    CubeList G(scratchResource());
+    cofactorInto(F, c, G);
+    return !G.empty() && tautology(move(G), numVars);
+}
+
+vector<Cube> allPrimes(const vector<Cube>& F, int numVars, size_t maxCubes, const CancelToken* cancel) {
+    // Live cubes, flat for the batch scans. A dropped cube stays in the array,
+    // flagged dead, until the end of the pass: anything it contains is also
+    // inside the live cube that replaced it, so containment checks may still
+    // match it.
+    vector<Cube> cubes;
+    vector<char> alive;
+    CubeArray array(numVars);
+    MatchMask hits;
+
+    auto add = [&](const Cube& c) {
+        matchContaining(c, array, hits);
+        for (uint64_t w : hits) {
+            if (w) return;
+        }
+        matchContainedIn(c, array, hits);
+        forEachMatch(hits, [&](size_t j) { alive[j] = 0; });
+        if (maxCubes > 0 && cubes.size() >= maxCubes) throw MemoryBudgetExceeded("consensus");
+        cubes.push_back(c);
+        alive.push_back(1);
+        array.push_back(c);
+    };
+    for (const Cube& c : F) add(c);
+
+    // Tison's method: one pass per variable, taking the consensus of every pair
+    // of cubes that disagree on it and nowhere else. The new cubes are free in
+    // that variable, so a pass never feeds itself, and once every variable has
+    // had its pass the live cubes are all the primes.
+    vector<Cube> negative;
+    vector<size_t> negativeIndex;
+    MatchMask one, two;
+    Cube c;
+    for (int v = 0; v < numVars && !cancelRequested(cancel); v++) {
+        vector<Cube> live;
+        for (size_t i = 0; i < cubes.size(); i++) {
+            if (alive[i]) live.push_back(cubes[i]);
+        }
+        cubes.swap(live);
+        alive.assign(cubes.size(), 1);
+        array = CubeArray(cubes, numVars);
+
+        negative.clear();
+        negativeIndex.clear();
+        for (size_t i = 0; i < cubes.size(); i++) {
+            if (cubes[i].literal(v) == '0') {
+                negative.push_back(cubes[i]);
+                negativeIndex.push_back(i);
+            }
+        }
+        if (negative.empty()) continue;
+        CubeArray negatives(negative, numVars);
+
+        size_t before = cubes.size();
+        for (size_t i = 0; i < before; i++) {
+            if ((i & 63) == 0 && cancelRequested(cancel)) break;
+            if (cubes[i].literal(v) != '1') continue;
+            matchDistance(cubes[i], negatives, one, two);
+            forEachMatch(one, [&](size_t k) {
+                if (!alive[i] || !alive[negativeIndex[k]]) return;
+                if (consensus(cubes[i], negative[k], c)) add(c);
+            });
+        }
+    }
+
+    vector<Cube> primes;
+    for (size_t i = 0; i < cubes.size(); i++) {
+        if (alive[i]) primes.push_back(cubes[i]);
+    }
+    sort(primes.begin(), primes.end());
+    return primes;
+}
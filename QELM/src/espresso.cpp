@@ -1,166 +1,783 @@
 #include "espresso.hpp"
+#include "cubeops.hpp"
+#include "quine.hpp"
 #include "utils.hpp"
-#include <map>
+#include "thread_pool.hpp"
+#include "arena.hpp"
+#include "profile.hpp"
+#include "cube_batch.hpp"
+#include "budget.hpp"
 #include <set>
 #include <algorithm>
-#include <iostream>
+#include <numeric>
 #include <random>
-#include <ctime>
+#include <chrono>
 
 using namespace std;
 
-// === Heuristic EXPAND with randomization ===
-vector<Term> expand(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars) {
-    vector<Term> expanded = onSet;
-    bool merged;
-    //This line creates a random number generator (rng) using the Mersenne Twister 19937 algorithm
-    mt19937 rng(static_cast<unsigned int>(time(nullptr)));
-
-    do {
-        merged = false;
-        vector<Term> newTerms;
-
-        vector<size_t> indices(expanded.size());
-        iota(indices.begin(), indices.end(), 0);
-        shuffle(indices.begin(), indices.end(), rng);
-
-        for (size_t iIdx = 0; iIdx < indices.size(); iIdx++) {
-            for (size_t jIdx = iIdx + 1; jIdx < indices.size(); jIdx++) {
-                size_t i = indices[iIdx];
-                size_t j = indices[jIdx];
-                if (expanded[i].canCombineWith(expanded[j])) {
-                    Term combined = expanded[i].combineWith(expanded[j]);
-                    if (find(newTerms.begin(), newTerms.end(), combined) == newTerms.end()) {
-                        newTerms.push_back(combined);
-                        merged = true;
-                    }
+static vector<Cube> toCubes(const vector<Term>& terms) {
+    vector<Cube> cubes;
+    cubes.reserve(terms.size());
+    for (const Term& t : terms) cubes.push_back(t.getCube());
+    return cubes;
+}
+
+static vector<Term> toTerms(const vector<Cube>& cubes, int numVars) {
+    vector<Term> terms;
+    terms.reserve(cubes.size());
+    for (const Cube& c : cubes) terms.push_back(Term(c, numVars));
+    return terms;
+}
+
+// Appends the cubes of F (also stored flat in A) that intersect c
+static void gatherIntersecting(const Cube& c, const vector<Cube>& F, const CubeArray& A, vector<Cube>& out) {
+    MatchMask hits;
+    matchIntersects(c, A, hits);
+    forEachMatch(hits, [&](size_t j) { out.push_back(F[j]); });
+}
+
+// Cover cost: fewer cubes first, then fewer literals
+static pair<size_t, int> coverCost(const vector<Term>& cover) {
+    return {cover.size(), countLiterals(cover)};
+}
+
+// An OFF cube is held as a Term, in the flat CubeArray the passes scan and,
+// while the complement is built, in its partial results
+static const size_t OFF_CUBE_BYTES = sizeof(Term) + 3 * sizeof(Cube);
+
+vector<Term> complementCover(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars,
+                             size_t memoryBudgetBytes) {
+    QELM_PROFILE_SCOPE(Complement);
+    vector<Cube> F = toCubes(onSet);
+    for (const Term& t : dcSet) F.push_back(t.getCube());
+    return toTerms(complement(F, numVars, budgetItems(memoryBudgetBytes, OFF_CUBE_BYTES)), numVars);
+}
+
+// Variables of word w where c clashes with OFF cube i
+static uint64_t clashWord(const Cube& c, const CubeArray& off, size_t i, int w) {
+    return (c.value[w] ^ off.values(w)[i]) & c.care[w] & off.cares(w)[i];
+}
+
+// Greedily raise literals of c. A literal is blocked when it is the last clash
+// with some OFF cube (distance 1); among the free ones, raise the literal that
+// would leave the fewest OFF cubes down to a single clash, i.e. the one shared
+// with the fewest cubes at distance 2 (ties broken by rng). Each step rescans
+// the OFF-set with the batch distance kernel.
+static Cube expandCube(Cube c, const CubeArray& off, int numVars, mt19937& rng) {
+    pmr::vector<int> score(numVars, 0, scratchResource());
+    pmr::vector<int> ties(scratchResource());
+    MatchMask one, two;
+    while (true) {
+        matchDistance(c, off, one, two);
+        uint64_t blocked[Cube::WORDS] = {0, 0, 0, 0};
+        forEachMatch(one, [&](size_t i) {
+            for (int w = 0; w < off.words(); w++) blocked[w] |= clashWord(c, off, i, w);
+        });
+        fill(score.begin(), score.end(), 0);
+        forEachMatch(two, [&](size_t i) {
+            for (int w = 0; w < off.words(); w++) {
+                uint64_t bits = clashWord(c, off, i, w);
+                while (bits) {
+                    score[w * 64 + __builtin_ctzll(bits)]++;
+                    bits &= bits - 1;
                 }
             }
-        }
+        });
 
-        for (const Term& dc : dcSet) {
-            for (size_t i = 0; i < expanded.size(); i++) {
-                if (expanded[i].canCombineWith(dc)) {
-                    Term combined = expanded[i].combineWith(dc);
-                    if (find(newTerms.begin(), newTerms.end(), combined) == newTerms.end()) {
-                        newTerms.push_back(combined);
-                        merged = true;
-                    }
+        ties.clear();
+        int bestScore = 0;
+        for (int w = 0; w < Cube::WORDS; w++) {
+            uint64_t free = c.care[w] & ~blocked[w];
+            while (free) {
+                int var = w * 64 + __builtin_ctzll(free);
+                free &= free - 1;
+                if (ties.empty() || score[var] < bestScore) {
+                    ties.assign(1, var);
+                    bestScore = score[var];
+                } else if (score[var] == bestScore) {
+                    ties.push_back(var);
                 }
             }
         }
+        if (ties.empty()) break;
 
-        for (const Term& t : newTerms) {
-            if (find(expanded.begin(), expanded.end(), t) == expanded.end()) {
-                expanded.push_back(t);
-            }
-        }
-    } while (merged);
+        int var = ties[rng() % ties.size()];
+        uint64_t bit = uint64_t(1) << (var & 63);
+        int w = var >> 6;
+        c.care[w] &= ~bit;
+        c.value[w] &= ~bit;
+    }
+    return c;
+}
+
+// === EXPAND against the OFF-set ===
+vector<Term> expand(const vector<Term>& cover, const vector<Term>& offSet, int numVars, mt19937& rng,
+                    const CancelToken* cancel) {
+    QELM_PROFILE_SCOPE(Expand);
+    vector<Cube> F = toCubes(cover);
+    CubeArray off(toCubes(offSet), numVars);
+    CubeArray candidates(F, numVars);
+
+    // Biggest cubes first: they are the most likely to swallow others
+    vector<size_t> order(F.size());
+    iota(order.begin(), order.end(), 0);
+    shuffle(order.begin(), order.end(), rng);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return F[a].countLiterals() < F[b].countLiterals();
+    });
+
+    vector<char> covered(F.size(), 0);
+    vector<Cube> expanded;
+    MatchMask inside;
+    bool stop = false;
+    for (size_t i : order) {
+        if (covered[i]) continue;
+        // Once cancelled, the rest of the cover goes through as it is
+        if (!stop) stop = cancelRequested(cancel);
+        Cube prime = stop ? F[i] : expandCube(F[i], off, numVars, rng);
+        matchContainedIn(prime, candidates, inside);
+        forEachMatch(inside, [&](size_t j) { covered[j] = 1; });
+        expanded.push_back(prime);
+    }
 
-    return expanded;
+    sort(expanded.begin(), expanded.end());
+    expanded.erase(unique(expanded.begin(), expanded.end()), expanded.end());
+    QELM_PROFILE_ADD(CubesGenerated, expanded.size());
+    return toTerms(expanded, numVars);
 }
 
-// === Heuristic REDUCE: literal count based cost ===
-vector<Term> reduce(const vector<Term>& expanded, const vector<Term>& onSet, int numVars) {
-    vector<Term> reduced = expanded;
+// === IRREDUNDANT: drop cubes the rest of the cover already covers ===
+// Each cube only ever looks at the cubes and dc cubes that meet it, found once
+// up front. A cube that was covered by all of its neighbours and has lost none
+// of them since is still covered, so it is dropped without another check.
+vector<Term> irredundant(const vector<Term>& cover, const vector<Term>& dcSet, int numVars) {
+    QELM_PROFILE_SCOPE(Irredundant);
+    vector<Cube> F = toCubes(cover);
+    vector<Cube> D = toCubes(dcSet);
+    size_t n = F.size();
 
-    for (auto it = reduced.begin(); it != reduced.end(); ) {
-        vector<Term> testCover = reduced;
-        testCover.erase(remove(testCover.begin(), testCover.end(), *it), testCover.end());
+    CubeArray cubes(F, numVars);
+    CubeArray dcCubes(D, numVars);
+    vector<vector<size_t>> neighbours(n);
+    vector<vector<size_t>> dcNeighbours(n);
+    MatchMask hits;
+    for (size_t i = 0; i < n; i++) {
+        matchIntersects(F[i], cubes, hits);
+        forEachMatch(hits, [&](size_t j) {
+            if (j <= i) return;
+            neighbours[i].push_back(j);
+            neighbours[j].push_back(i);
+        });
+        matchIntersects(F[i], dcCubes, hits);
+        forEachMatch(hits, [&](size_t d) { dcNeighbours[i].push_back(d); });
+    }
 
-        set<int> coveredMinterms;
-        for (const Term& t : testCover) {
-            for (int m : t.getCoveredMinterms()) {
-                coveredMinterms.insert(m);
-            }
+    vector<char> removed(n, 0);
+    vector<Cube> others;
+    auto coveredByRest = [&](size_t i) {
+        others.clear();
+        for (size_t j : neighbours[i]) {
+            if (!removed[j]) others.push_back(F[j]);
         }
+        for (size_t d : dcNeighbours[i]) others.push_back(D[d]);
+        return coversCube(others, F[i], numVars);
+    };
 
-        bool isEssential = false;
-        for (int m : it->getCoveredMinterms()) {
-            if (coveredMinterms.find(m) == coveredMinterms.end()) {
-                isEssential = true;
-                break;
-            }
-        }
+    // Relatively essential cubes are needed whatever else goes
+    vector<char> redundant(n, 0);
+    for (size_t i = 0; i < n; i++) redundant[i] = coveredByRest(i);
 
-        if (isEssential) {
-            it++;
-        } else {
-            it = reduced.erase(it);
+    // Smallest cubes are tried first
+    vector<size_t> order;
+    for (size_t i = 0; i < n; i++) {
+        if (redundant[i]) order.push_back(i);
+    }
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return F[a].countLiterals() > F[b].countLiterals();
+    });
+
+    vector<int> lostNeighbours(n, 0);
+    for (size_t i : order) {
+        if (lostNeighbours[i] > 0 && !coveredByRest(i)) continue;
+        removed[i] = 1;
+        for (size_t j : neighbours[i]) lostNeighbours[j]++;
+    }
+
+    vector<Cube> kept;
+    for (size_t i = 0; i < n; i++) {
+        if (!removed[i]) kept.push_back(F[i]);
+    }
+    return toTerms(kept, numVars);
+}
+
+// === REDUCE: shrink each cube to the supercube of the part only it covers ===
+vector<Term> reduce(const vector<Term>& cover, const vector<Term>& dcSet, int numVars) {
+    QELM_PROFILE_SCOPE(Reduce);
+    vector<Cube> F = toCubes(cover);
+    vector<Cube> D = toCubes(dcSet);
+
+    // Biggest cubes first, each one seeing the already reduced ones
+    vector<size_t> order(F.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return F[a].countLiterals() < F[b].countLiterals();
+    });
+
+    CubeArray cubes(F, numVars);
+    CubeArray dcCubes(D, numVars);
+    vector<char> removed(F.size(), 0);
+    vector<Cube> others;
+    MatchMask hits;
+    for (size_t i : order) {
+        others.clear();
+        matchIntersects(F[i], cubes, hits);
+        forEachMatch(hits, [&](size_t j) {
+            if (j != i && !removed[j]) others.push_back(F[j]);
+        });
+        gatherIntersecting(F[i], D, dcCubes, others);
+
+        Cube sc;
+        if (!supercubeOfComplement(cofactor(others, F[i]), numVars, sc)) {
+            removed[i] = 1;
+            continue;
+        }
+        for (int w = 0; w < Cube::WORDS; w++) {
+            F[i].care[w] |= sc.care[w];
+            F[i].value[w] |= sc.value[w];
         }
+        cubes.set(i, F[i]);
     }
 
-    return reduced;
+    vector<Cube> reduced;
+    for (size_t i = 0; i < F.size(); i++) {
+        if (!removed[i]) reduced.push_back(F[i]);
+    }
+    return toTerms(reduced, numVars);
 }
 
-vector<Term> extractEssential(const vector<Term>& reduced, const vector<Term>& onSet, int numVars) {
+// === ESSENTIAL: a prime p is essential when the consensus of the rest of
+// the cover and dc-set with p does not cover p ===
+vector<Term> extractEssential(const vector<Term>& cover, const vector<Term>& dcSet, int numVars) {
+    QELM_PROFILE_SCOPE(Essential);
+    vector<Cube> F = toCubes(cover);
+    vector<Cube> D = toCubes(dcSet);
     vector<Term> essential;
-    map<int, vector<Term>> coverageChart;
 
-    for (const auto& term : reduced) {
-        for (int minterm : term.getCoveredMinterms()) {
-            coverageChart[minterm].push_back(term);
+    vector<Cube> H;
+    for (size_t i = 0; i < F.size(); i++) {
+        H.clear();
+        Cube c;
+        for (size_t j = 0; j < F.size(); j++) {
+            if (j != i && consensus(F[j], F[i], c)) H.push_back(c);
+        }
+        for (const Cube& d : D) {
+            if (consensus(d, F[i], c)) H.push_back(c);
+        }
+        if (!coversCube(H, F[i], numVars)) {
+            essential.push_back(Term(F[i], numVars));
         }
     }
 
-    set<Term> selected;
+    return essential;
+}
+
+// One EXPAND / IRREDUNDANT / REDUCE run over a precomputed OFF-set. Every
+// step keeps F a valid cover, so when cancel fires the pass stops where it is.
+static vector<Term> espressoPass(const vector<Term>& onSet, const vector<Term>& dcSet,
+                                 const vector<Term>& offSet, int numVars, unsigned seed,
+                                 const CancelToken* cancel = nullptr) {
+    ArenaScope scope("espresso pass");
 
-    for (const auto& [minterm, terms] : coverageChart) {
-        if (terms.size() == 1 && selected.find(terms[0]) == selected.end()) {
-            essential.push_back(terms[0]);
-            selected.insert(terms[0]);
+    //This line creates a random number generator (rng) using the Mersenne Twister 19937 algorithm
+    mt19937 rng(seed);
+
+    vector<Term> F = expand(onSet, offSet, numVars, rng, cancel);
+    QELM_PROFILE_MAX(PeakCoverSize, F.size());
+    if (cancelRequested(cancel)) return F;
+    F = irredundant(F, dcSet, numVars);
+
+    // Essential primes are in every cover: set them aside as don't-cares for the loop
+    vector<Term> essential = extractEssential(F, dcSet, numVars);
+    set<Cube> essentialCubes;
+    for (const Term& t : essential) essentialCubes.insert(t.getCube());
+
+    vector<Term> dcPlus = dcSet;
+    dcPlus.insert(dcPlus.end(), essential.begin(), essential.end());
+    F.erase(remove_if(F.begin(), F.end(), [&](const Term& t) {
+        return essentialCubes.count(t.getCube()) > 0;
+    }), F.end());
+
+    // REDUCE / EXPAND / IRREDUNDANT until the cost stops improving
+    pair<size_t, int> cost = coverCost(F);
+    while (!F.empty() && !cancelRequested(cancel)) {
+        vector<Term> G = reduce(F, dcPlus, numVars);
+        G = expand(G, offSet, numVars, rng, cancel);
+        G = irredundant(G, dcPlus, numVars);
+
+        pair<size_t, int> newCost = coverCost(G);
+        if (newCost >= cost) break;
+        F = G;
+        cost = newCost;
+    }
+
+    F.insert(F.end(), essential.begin(), essential.end());
+    sort(F.begin(), F.end());
+    return F;
+}
+
+vector<Term> runEspressoOnce(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars, unsigned seed) {
+    if (onSet.empty()) return {};
+    vector<Term> offSet = complementCover(onSet, dcSet, numVars);
+    return espressoPass(onSet, dcSet, offSet, numVars, seed);
+}
+
+// splitmix64 step: spreads (base seed, pass index) into unrelated pass seeds
+static unsigned passSeed(unsigned base, int pass) {
+    uint64_t z = (static_cast<uint64_t>(base) << 32) + static_cast<uint64_t>(pass) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<unsigned>(z ^ (z >> 31));
+}
+
+// Runs pass(seed) for every pass of options and keeps the cheapest result.
+// Passes run in waves of numThreads. Results are taken in pass order, so the
+// best cover and the stopping point do not depend on scheduling (unless a
+// time limit cuts the run short).
+template <class Result, class Pass, class Cost>
+static Result bestOfPasses(const EspressoOptions& options, Pass pass, Cost cost) {
+    int passes = max(1, options.passes);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    auto outOfTime = [&]() {
+        if (cancelRequested(options.cancel)) return true;
+        return options.timeLimitSeconds > 0 &&
+               chrono::duration<double>(chrono::steady_clock::now() - start).count() >= options.timeLimitSeconds;
+    };
+
+    Result best;
+    decltype(cost(best)) bestCost;
+    int stall = 0;
+    auto consider = [&](int i, Result& current) {
+        auto currentCost = cost(current);
+        if (i == 0 || currentCost < bestCost) {
+            best = std::move(current);
+            bestCost = currentCost;
+            stall = 0;
+        } else {
+            stall++;
         }
+        return options.stopAfterStall > 0 && stall >= options.stopAfterStall;
+    };
+
+    int numThreads = options.numThreads;
+    if (numThreads <= 0) numThreads = static_cast<int>(max(1u, thread::hardware_concurrency()));
+    numThreads = min(numThreads, passes);
+
+    if (numThreads == 1) {
+        for (int i = 0; i < passes; i++) {
+            Result current = pass(passSeed(options.seed, i));
+            if (consider(i, current) || outOfTime()) break;
+        }
+        return best;
     }
 
-    set<int> covered;
-    for (const Term& t : essential) {
-        for (int m : t.getCoveredMinterms()) {
-            covered.insert(m);
+    ThreadPool pool(numThreads);
+    for (int first = 0; first < passes; first += numThreads) {
+        int last = min(passes, first + numThreads);
+        vector<future<Result>> wave;
+        for (int i = first; i < last; i++) {
+            unsigned seed = passSeed(options.seed, i);
+            wave.push_back(pool.submit([&pass, seed]() { return pass(seed); }));
+        }
+
+        bool stop = false;
+        for (int i = first; i < last; i++) {
+            Result current = wave[i - first].get();
+            if (!stop) stop = consider(i, current);
         }
+        if (stop || outOfTime()) break;
+    }
+
+    return best;
+}
+
+vector<Term> runEspressoMultiple(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars, const EspressoOptions& options) {
+    if (onSet.empty()) return {};
+
+    // The OFF-set does not depend on the seed, so every pass shares it
+    vector<Term> offSet = complementCover(onSet, dcSet, numVars, options.memoryBudgetBytes);
+
+    return bestOfPasses<vector<Term>>(options,
+        [&](unsigned seed) { return espressoPass(onSet, dcSet, offSet, numVars, seed, options.cancel); },
+        [](const vector<Term>& cover) { return make_pair(countLiterals(cover), cover.size()); });
+}
+
+vector<Term> runEspressoMultiple(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars, int passes) {
+    EspressoOptions options;
+    options.passes = passes;
+    return runEspressoMultiple(onSet, dcSet, numVars, options);
+}
+
+// === Incremental update ===
+
+// Raise literals of c while it stays inside the care set (on + dc). Slower per
+// cube than expand, but needs no OFF-set, which is what a small edit must avoid.
+static Cube raiseInCare(Cube c, const vector<Cube>& care, const CubeArray& careArray, int numVars) {
+    vector<Cube> near;
+    for (int j = 0; j < numVars; j++) {
+        if (c.literal(j) == '-') continue;
+        Cube raised = c;
+        raised.setLiteral(j, '-');
+        near.clear();
+        gatherIntersecting(raised, care, careArray, near);
+        if (coversCube(near, raised, numVars)) c = raised;
     }
+    return c;
+}
 
-    for (const Term& t : reduced) {
-        bool addsCoverage = false;
-        for (int m : t.getCoveredMinterms()) {
-            if (covered.find(m) == covered.end()) {
-                addsCoverage = true;
-                break;
+vector<Term> updateCover(const vector<Term>& previous, const vector<Term>& onSet, const vector<Term>& dcSet,
+                         const CoverDelta& delta, int numVars) {
+    if (onSet.empty()) return {};
+    ArenaScope scope("espresso update");
+
+    vector<Cube> on = toCubes(onSet);
+    vector<Cube> care = on;
+    for (const Term& t : dcSet) care.push_back(t.getCube());
+    CubeArray onArray(on, numVars);
+    CubeArray careArray(care, numVars);
+
+    // Where the function lost points; a previous cube can only turn invalid there
+    vector<Cube> removed = toCubes(delta.removedOn);
+    for (const Term& t : delta.removedDc) removed.push_back(t.getCube());
+    // Where cubes may now grow
+    vector<Cube> grown = toCubes(delta.addedOn);
+    for (const Term& t : delta.addedDc) grown.push_back(t.getCube());
+    CubeArray removedArray(removed, numVars);
+    CubeArray grownArray(grown, numVars);
+
+    vector<Cube> kept, touched;
+    vector<Cube> near;
+    MatchMask hits;
+    for (const Term& t : previous) {
+        const Cube& c = t.getCube();
+        if (!anyIntersects(c, removedArray)) {
+            (anyIntersects(c, grownArray) ? touched : kept).push_back(c);
+            continue;
+        }
+        near.clear();
+        gatherIntersecting(c, care, careArray, near);
+        if (coversCube(near, c, numVars)) {
+            touched.push_back(c);
+            continue;
+        }
+        // c now reaches the OFF-set: keep the on-set parts it held, raised again below
+        matchIntersects(c, onArray, hits);
+        forEachMatch(hits, [&](size_t j) {
+            Cube part = on[j];
+            for (int w = 0; w < Cube::WORDS; w++) {
+                part.care[w] |= c.care[w];
+                part.value[w] |= c.value[w];
             }
+            touched.push_back(part);
+        });
+    }
+
+    // Added on rows the cover misses
+    vector<Cube> coverNow = kept;
+    coverNow.insert(coverNow.end(), touched.begin(), touched.end());
+    for (const Term& t : dcSet) coverNow.push_back(t.getCube());
+    CubeArray coverNowArray(coverNow, numVars);
+    for (const Term& t : delta.addedOn) {
+        near.clear();
+        gatherIntersecting(t.getCube(), coverNow, coverNowArray, near);
+        if (!coversCube(near, t.getCube(), numVars)) touched.push_back(t.getCube());
+    }
+
+    // The region is the touched cubes, raised, plus the kept cubes they meet.
+    // Everything else of the cover stands in as don't care while it is reworked.
+    vector<Cube> raised;
+    for (const Cube& c : touched) raised.push_back(raiseInCare(c, care, careArray, numVars));
+    CubeArray raisedArray(raised, numVars);
+    vector<Term> region = toTerms(raised, numVars);
+    vector<Term> rest = dcSet;
+    vector<Term> untouched;
+    for (const Cube& c : kept) {
+        if (anyIntersects(c, raisedArray)) region.push_back(Term(c, numVars));
+        else untouched.push_back(Term(c, numVars));
+    }
+    sort(region.begin(), region.end());
+    region.erase(unique(region.begin(), region.end()), region.end());
+    rest.insert(rest.end(), untouched.begin(), untouched.end());
+
+    region = irredundant(region, rest, numVars);
+
+    // Same improvement loop as a pass, limited to the region
+    auto raiseAll = [&](const vector<Term>& cubes) {
+        vector<Cube> out;
+        for (const Term& t : cubes) out.push_back(raiseInCare(t.getCube(), care, careArray, numVars));
+        sort(out.begin(), out.end());
+        out.erase(unique(out.begin(), out.end()), out.end());
+        return toTerms(out, numVars);
+    };
+    pair<size_t, int> cost = coverCost(region);
+    while (!region.empty()) {
+        vector<Term> next = irredundant(raiseAll(reduce(region, rest, numVars)), rest, numVars);
+        pair<size_t, int> nextCost = coverCost(next);
+        if (nextCost >= cost) break;
+        region = next;
+        cost = nextCost;
+    }
+
+    // Raising may have grown the region over untouched cubes, which can make them redundant
+    CubeArray regionArray(toCubes(region), numVars);
+    vector<Term> outside = dcSet;
+    for (const Term& t : untouched) {
+        if (anyIntersects(t.getCube(), regionArray)) region.push_back(t);
+        else outside.push_back(t);
+    }
+    region = irredundant(region, outside, numVars);
+    region.insert(region.end(), outside.begin() + dcSet.size(), outside.end());
+    sort(region.begin(), region.end());
+    return region;
+}
+
+// === Shared multi-output minimization ===
+
+// Input cube plus the outputs it feeds. (in, out) is valid when in misses the
+// OFF-set of every output in out.
+struct SharedCube {
+    Cube in;
+    OutputMask out;
+};
+
+vector<vector<PLACube>> groupByOutput(const vector<PLACube>& cubes, int numOutputs) {
+    vector<vector<PLACube>> grouped(numOutputs);
+    for (const PLACube& c : cubes) {
+        for (int k = 0; k < numOutputs; k++) {
+            if (c.outputs.test(k)) grouped[k].push_back(c);
         }
+    }
+    return grouped;
+}
 
-        if (addsCoverage && selected.find(t) == selected.end()) {
-            essential.push_back(t);
-            for (int m : t.getCoveredMinterms()) {
-                covered.insert(m);
+// Cubes that can cover part of F[i] for output k: other live cubes feeding k, plus k's dc-set
+static void othersForOutput(const vector<SharedCube>& F, const vector<char>& removed, size_t i, int k,
+                            const vector<Cube>& dc, vector<Cube>& others) {
+    others.clear();
+    for (size_t j = 0; j < F.size(); j++) {
+        if (j != i && !removed[j] && F[j].out.test(k) && F[j].in.intersects(F[i].in)) others.push_back(F[j].in);
+    }
+    for (const Cube& d : dc) {
+        if (d.intersects(F[i].in)) others.push_back(d);
+    }
+}
+
+static vector<SharedCube> keepLive(const vector<SharedCube>& F, const vector<char>& removed) {
+    vector<SharedCube> kept;
+    for (size_t i = 0; i < F.size(); i++) {
+        if (!removed[i]) kept.push_back(F[i]);
+    }
+    return kept;
+}
+
+// Expand the input part against the OFF-sets of the outputs the cube feeds,
+// then connect it to every other output whose OFF-set it misses
+static vector<SharedCube> expandShared(const vector<SharedCube>& F, const vector<vector<Cube>>& off,
+                                       int numVars, int numOutputs, mt19937& rng, const CancelToken* cancel) {
+    QELM_PROFILE_SCOPE(Expand);
+    vector<size_t> order(F.size());
+    iota(order.begin(), order.end(), 0);
+    shuffle(order.begin(), order.end(), rng);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return F[a].in.countLiterals() < F[b].in.countLiterals();
+    });
+
+    vector<Cube> inputs;
+    for (const SharedCube& c : F) inputs.push_back(c.in);
+    CubeArray candidates(inputs, numVars);
+
+    vector<char> covered(F.size(), 0);
+    vector<SharedCube> expanded;
+    CubeArray blocking(numVars);
+    MatchMask inside;
+    bool stop = false;
+    for (size_t i : order) {
+        if (covered[i]) continue;
+        SharedCube p = F[i];
+        // Once cancelled, the rest of the cover goes through as it is
+        if (!stop) stop = cancelRequested(cancel);
+        if (stop) {
+            expanded.push_back(p);
+            continue;
+        }
+
+        blocking.clear();
+        for (int k = 0; k < numOutputs; k++) {
+            if (!p.out.test(k)) continue;
+            for (const Cube& r : off[k]) blocking.push_back(r);
+        }
+        p.in = expandCube(p.in, blocking, numVars, rng);
+
+        for (int k = 0; k < numOutputs; k++) {
+            if (p.out.test(k)) continue;
+            bool disjoint = true;
+            for (const Cube& r : off[k]) {
+                if (r.intersects(p.in)) {
+                    disjoint = false;
+                    break;
+                }
             }
-            selected.insert(t);
+            if (disjoint) p.out.set(k);
         }
+
+        matchContainedIn(p.in, candidates, inside);
+        forEachMatch(inside, [&](size_t j) {
+            if (p.out.contains(F[j].out)) covered[j] = 1;
+        });
+        expanded.push_back(p);
     }
 
-    return essential;
+    // Same input part twice: one cube feeding the union of the outputs is still valid
+    sort(expanded.begin(), expanded.end(), [](const SharedCube& a, const SharedCube& b) { return a.in < b.in; });
+    vector<SharedCube> merged;
+    for (const SharedCube& c : expanded) {
+        if (!merged.empty() && merged.back().in == c.in) merged.back().out.unite(c.out);
+        else merged.push_back(c);
+    }
+    QELM_PROFILE_ADD(CubesGenerated, merged.size());
+    return merged;
 }
 
-vector<Term> runEspressoOnce(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars) {
-    vector<Term> expanded = expand(onSet, dcSet, numVars);
-    vector<Term> reduced = reduce(expanded, onSet, numVars);
-    return extractEssential(reduced, onSet, numVars);
+// Disconnect outputs that the rest of the cover already handles; drop cubes left with none
+static vector<SharedCube> irredundantShared(vector<SharedCube> F, const vector<vector<Cube>>& dc,
+                                            int numVars, int numOutputs) {
+    QELM_PROFILE_SCOPE(Irredundant);
+    vector<size_t> order(F.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return F[a].in.countLiterals() > F[b].in.countLiterals();
+    });
+
+    vector<char> removed(F.size(), 0);
+    vector<Cube> others;
+    for (size_t i : order) {
+        for (int k = 0; k < numOutputs; k++) {
+            if (!F[i].out.test(k)) continue;
+            othersForOutput(F, removed, i, k, dc[k], others);
+            if (coversCube(others, F[i].in, numVars)) F[i].out.reset(k);
+        }
+        if (!F[i].out.any()) removed[i] = 1;
+    }
+    return keepLive(F, removed);
 }
 
+// Shrink each input part to the supercube of what only it covers, over all of its outputs
+static vector<SharedCube> reduceShared(vector<SharedCube> F, const vector<vector<Cube>>& dc,
+                                       int numVars, int numOutputs) {
+    QELM_PROFILE_SCOPE(Reduce);
+    vector<size_t> order(F.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return F[a].in.countLiterals() < F[b].in.countLiterals();
+    });
 
+    vector<char> removed(F.size(), 0);
+    vector<Cube> others, uncovered;
+    for (size_t i : order) {
+        uncovered.clear();
+        for (int k = 0; k < numOutputs; k++) {
+            if (!F[i].out.test(k)) continue;
+            othersForOutput(F, removed, i, k, dc[k], others);
+            Cube onlyHere;
+            if (supercubeOfComplement(cofactor(others, F[i].in), numVars, onlyHere)) uncovered.push_back(onlyHere);
+            else F[i].out.reset(k);
+        }
+        if (!F[i].out.any()) {
+            removed[i] = 1;
+            continue;
+        }
+        Cube sc = supercube(uncovered);
+        for (int w = 0; w < Cube::WORDS; w++) {
+            F[i].in.care[w] |= sc.care[w];
+            F[i].in.value[w] |= sc.value[w];
+        }
+    }
+    return keepLive(F, removed);
+}
 
-vector<Term> runEspressoMultiple(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars, int passes) {
-    vector<Term> best = runEspressoOnce(onSet, dcSet, numVars);
-    int minLiterals = countLiterals(best);
+// Cost of a shared cover: product terms, then input literals plus output connections
+static pair<size_t, int> sharedCost(const vector<SharedCube>& F) {
+    int literals = 0;
+    for (const SharedCube& c : F) literals += c.in.countLiterals() + c.out.count();
+    return {F.size(), literals};
+}
 
-    for (int i = 1; i < passes; i++) {
-        vector<Term> current = runEspressoOnce(onSet, dcSet, numVars);
-        int currentLiterals = countLiterals(current);
+vector<PLACube> runEspressoMultiOutput(const vector<PLACube>& onSet, const vector<PLACube>& dcSet,
+                                       int numVars, int numOutputs, const EspressoOptions& options) {
+    vector<vector<Cube>> on(numOutputs), dc(numOutputs), off(numOutputs);
+    vector<SharedCube> start;
+    for (const PLACube& c : onSet) {
+        if (!c.outputs.any()) continue;
+        start.push_back({c.term.getCube(), c.outputs});
+        for (int k = 0; k < numOutputs; k++) {
+            if (c.outputs.test(k)) on[k].push_back(c.term.getCube());
+        }
+    }
+    for (const PLACube& c : dcSet) {
+        for (int k = 0; k < numOutputs; k++) {
+            if (c.outputs.test(k)) dc[k].push_back(c.term.getCube());
+        }
+    }
+    if (start.empty()) return {};
 
-        if (currentLiterals < minLiterals) {
-            best = current;
-            minLiterals = currentLiterals;
+    {
+        QELM_PROFILE_SCOPE(Complement);
+        // The budget covers the OFF-sets of all outputs together
+        size_t maxCubes = budgetItems(options.memoryBudgetBytes, OFF_CUBE_BYTES);
+        size_t held = 0;
+        for (int k = 0; k < numOutputs; k++) {
+            vector<Cube> care = on[k];
+            care.insert(care.end(), dc[k].begin(), dc[k].end());
+            off[k] = complement(care, numVars, maxCubes > 0 ? maxCubes - held : 0);
+            held += off[k].size();
+            if (maxCubes > 0 && held >= maxCubes) throw MemoryBudgetExceeded("the OFF-sets");
         }
     }
 
-    return best;
+    auto pass = [&](unsigned seed) {
+        ArenaScope scope("espresso shared pass");
+        mt19937 rng(seed);
+        vector<SharedCube> F = expandShared(start, off, numVars, numOutputs, rng, options.cancel);
+        QELM_PROFILE_MAX(PeakCoverSize, F.size());
+        if (cancelRequested(options.cancel)) return F;
+        F = irredundantShared(F, dc, numVars, numOutputs);
+
+        pair<size_t, int> cost = sharedCost(F);
+        while (!F.empty() && !cancelRequested(options.cancel)) {
+            vector<SharedCube> G = reduceShared(F, dc, numVars, numOutputs);
+            G = expandShared(G, off, numVars, numOutputs, rng, options.cancel);
+            G = irredundantShared(G, dc, numVars, numOutputs);
+
+            pair<size_t, int> newCost = sharedCost(G);
+            if (newCost >= cost) break;
+            F = G;
+            cost = newCost;
+        }
+        return F;
+    };
+
+    vector<SharedCube> best = bestOfPasses<vector<SharedCube>>(options, pass, sharedCost);
+
+    vector<PLACube> result;
+    for (const SharedCube& c : best) {
+        result.push_back(PLACube(Term(c.in, numVars), c.out));
+    }
+    return result;
+}
+
+vector<string> espressoTermsToSOP(const vector<vector<Term>>& result, int numVars) {
+    vector<string> expressions;
+    for (const vector<Term>& cover : result) {
+        expressions.push_back(termsToSOP(cover, numVars));
+    }
+    return expressions;
 }
@@ -1,133 +1,182 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
-#include <sstream>
-#include <iterator>
-#include <set>
+#include <stdexcept>
+#include <csignal>
 
 #include "term.hpp"
 #include "quine.hpp"
-#include "espresso.hpp"
+#include "pla.hpp"
+#include "minimizer.hpp"
+#include "profile.hpp"
+#include "writer.hpp"
+#include "batch.hpp"
 
 using namespace std;
 
-// Function to minimize using Espresso (multi-pass)
-vector<Term> minimizeEspresso(const vector<Term>& minterms, const vector<Term>& dontCares, int numVars, int passes = 5) {
-    return runEspressoMultiple(minterms, dontCares, numVars, passes);
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options] [input.pla [output.txt]]\n"
+         << "       " << program << " [options] --batch OUTDIR input.pla|DIR|@LIST...\n"
+         << "  --engine auto|quine|espresso|bdd   minimizer (default auto: chosen per output)\n"
+         << "  --passes N                          Espresso passes (default 5)\n"
+         << "  --seed N                            Espresso seed (default 1)\n"
+         << "  --threads N                         worker threads, 0 = all cores (default 0)\n"
+         << "  --time-budget SECONDS               per-output search budget, 0 = none (default 0)\n"
+         << "  --cache DIR                         reuse covers cached in DIR (default: no cache)\n"
+         << "  --deadline SECONDS                  stop minimizing after this long and write the\n"
+         << "                                      best covers so far; so do SIGINT and SIGTERM\n"
+         << "  --memory-budget MB                  memory for the engines' tables; past it they\n"
+         << "                                      fall back to cheaper engines (default: no limit)\n"
+         << "  --format report|pla|binary          output: text report, PLA of the covers or\n"
+         << "                                      binary cube list (default report)\n"
+         << "  --batch OUTDIR                      minimize every input (a DIR means its .pla\n"
+         << "                                      files, @LIST the paths listed in LIST) on one\n"
+         << "                                      thread pool, one output each in OUTDIR\n"
+         << "  --summary PATH                      batch summary (default OUTDIR/summary.tsv)\n"
+         << "Input and output default to ./data/input.txt and ./data/output.txt.\n";
 }
 
-
-// Helper to parse PLA format
-bool parsePLA(const string& filename, int& numVars, int& numOutputs,
-              vector<vector<Term>>& allMinterms, vector<vector<Term>>& allDontCares,
-              vector<string>& inputLabels, vector<string>& outputLabels) {
-    ifstream fin(filename);
-    if (!fin) {
-        cerr << "Error opening input file\n";
-        return false;
-    }
-
-    string line;
-    numVars = 0;
-    numOutputs = 1; // default single output
-
-    while (getline(fin, line)) {
-        if (line.empty() || line[0] == '#') continue; // skip comments
-
-        if (line.substr(0, 3) == ".i ") {
-            numVars = stoi(line.substr(3));
-        } else if (line.substr(0, 3) == ".o ") {
-            numOutputs = stoi(line.substr(3));
-            allMinterms.resize(numOutputs);// resize can cause memory bugs
-            allDontCares.resize(numOutputs);
-        } else if (line.substr(0, 4) == ".ilb") {
-            istringstream ss(line.substr(5));
-            inputLabels = {istream_iterator<string>(ss), {}};
-        } else if (line.substr(0, 3) == ".ob") {
-            istringstream ss(line.substr(4));
-            outputLabels = {istream_iterator<string>(ss), {}};
-        } else if (line.substr(0, 2) == ".e") {
-            break; // end of PLA
-        } else if (line[0] == '0' || line[0] == '1' || line[0] == '-') {
-            istringstream iss(line);
-            string inputBits, outputBits;
-            iss >> inputBits >> outputBits;
-
-            int decimal = 0;
-            for (char c : inputBits) {
-                decimal <<= 1;
-                if (c == '1') decimal |= 1;
-            }
-            set<int> covered = {decimal};
-
-            for (int i = 0; i < outputBits.size(); i++) {
-                Term t(inputBits, covered, outputBits[i] == '-');
-                if (outputBits[i] == '1') {
-                    allMinterms[i].push_back(t);
-                } else if (outputBits[i] == '-') {
-                    allDontCares[i].push_back(t);
+// Parses the command line into options and paths; false on a bad argument
+static bool parseArgs(int argc, char* argv[], MinimizerOptions& options, double& deadline, string& format,
+                      string& batchDirectory, string& summaryFile, vector<string>& paths) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-h" || arg == "--help") return false;
+        if (arg.rfind("--", 0) != 0) {
+            paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        string value = argv[++i];
+        try {
+            if (arg == "--engine") {
+                if (!parseEngine(value, options.engine)) {
+                    cerr << "Unknown engine " << value << "\n";
+                    return false;
+                }
+            } else if (arg == "--passes") {
+                options.passes = stoi(value);
+            } else if (arg == "--seed") {
+                options.seed = static_cast<unsigned>(stoul(value));
+            } else if (arg == "--threads") {
+                options.numThreads = stoi(value);
+            } else if (arg == "--time-budget") {
+                options.timeBudgetSeconds = stod(value);
+            } else if (arg == "--cache") {
+                options.cacheDirectory = value;
+            } else if (arg == "--deadline") {
+                deadline = stod(value);
+                if (deadline <= 0) throw invalid_argument(value);
+            } else if (arg == "--memory-budget") {
+                double megabytes = stod(value);
+                if (megabytes < 0) throw invalid_argument(value);
+                options.memoryBudgetBytes = static_cast<size_t>(megabytes * (1 << 20));
+            } else if (arg == "--format") {
+                if (value != "report" && value != "pla" && value != "binary") {
+                    cerr << "Unknown format " << value << "\n";
+                    return false;
                 }
+                format = value;
+            } else if (arg == "--batch") {
+                batchDirectory = value;
+            } else if (arg == "--summary") {
+                summaryFile = value;
+            } else {
+                cerr << "Unknown option " << arg << "\n";
+                return false;
             }
+        } catch (const logic_error&) {
+            cerr << "Bad value for " << arg << ": " << value << "\n";
+            return false;
         }
     }
-
-    fin.close();
-    return true;
+    if (batchDirectory.empty()) return paths.size() <= 2 && summaryFile.empty();
+    return !paths.empty();
 }
 
-int main() {
-    const string inputFile = "./data/input.txt";
-    const string outputFile = "./data/output.txt";
+static int runBatchMode(const MinimizerOptions& options, const string& format, const string& batchDirectory,
+                        string summaryFile, const vector<string>& paths) {
+    vector<string> files;
+    if (!collectBatchInputs(paths, files)) return 1;
+    if (files.empty()) {
+        cerr << "No PLA files to minimize\n";
+        return 1;
+    }
 
-    int numVars, numOutputs;
-    vector<vector<Term>> allMinterms, allDontCares;
-    vector<string> inputLabels, outputLabels;
+    BatchOptions batch;
+    batch.minimizer = options;
+    batch.outputDirectory = batchDirectory;
+    batch.format = format;
+    BatchSummary summary = runBatch(files, batch);
+    for (const BatchFileResult& file : summary.files) {
+        if (!file.error.empty()) cerr << file.input << ": " << file.error << "\n";
+    }
 
-    if (!parsePLA(inputFile, numVars, numOutputs, allMinterms, allDontCares, inputLabels, outputLabels)) {
-        cerr << "Failed to parse PLA input\n";
+    if (summaryFile.empty()) summaryFile = batchDirectory + "/summary.tsv";
+    if (!writeBatchSummary(summaryFile, summary)) {
+        cerr << "Error writing batch summary\n";
         return 1;
     }
+    cout << "Batch done: " << summary.files.size() - summary.failed << " of " << summary.files.size()
+         << " files minimized. Summary in " << summaryFile << "\n";
+    return summary.failed == 0 ? 0 : 1;
+}
 
-    ofstream fout(outputFile);
-    if (!fout) {
-        cerr << "Error opening output file\n";
+int main(int argc, char* argv[]) {
+    MinimizerOptions options;
+    string inputFile = "./data/input.txt";
+    string outputFile = "./data/output.txt";
+    string format = "report";
+    double deadline = 0;
+    string batchDirectory, summaryFile;
+    vector<string> paths;
+    if (!parseArgs(argc, argv, options, deadline, format, batchDirectory, summaryFile, paths)) {
+        printUsage(argv[0]);
         return 1;
     }
-    
-    fout << "# Minimization Report \n";
-    fout << "# Variables: " << numVars << "\n\n";
 
-    if (numVars > 10) {
-        int passes;
-        cout << "\n You're using Espresso minimization for more than 10 variables." << endl;
-        cout << " The number of passes controls how many variations are tried." << endl;
-        cout << " More passes = better result, but takes more time!" << endl;
-        cout << " Enter number of passes to use (e.g. 5, 10, 20): ";
-        cin >> passes;
-        if (passes <= 0) {
-            cout << " Invalid input! Using default passes = 5\n";
-            passes = 5;
-        }
+    // A scheduler's SIGTERM (or ^C) cuts the run short instead of losing it;
+    // a second signal kills the process as usual
+    static CancelToken job;
+    job.setDeadline(deadline);
+    options.cancel = &job;
+    struct sigaction action = {};
+    action.sa_handler = [](int) { job.cancel(); };
+    action.sa_flags = SA_RESETHAND;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    if (!batchDirectory.empty()) return runBatchMode(options, format, batchDirectory, summaryFile, paths);
+    if (paths.size() > 0) inputFile = paths[0];
+    if (paths.size() > 1) outputFile = paths[1];
+
+    PLAFile pla;
+    if (!parsePLA(inputFile, pla)) {
+        cerr << "Failed to parse PLA input\n";
+        return 1;
+    }
 
-        fout << "Using Espresso Minimizer for variables > 10\n\n";
-        for (int i = 0; i < numOutputs; i++) {
-            fout << "# Output function " << (outputLabels.empty() ? to_string(i) : outputLabels[i]) << "\n";
-            vector<Term> minimized = minimizeEspresso(allMinterms[i], allDontCares[i], numVars, passes);
-            vector<string> expressions = espressoTermsToSOP({minimized}, numVars);
-            fout << expressions[0] << "\n\n";
-        }
-        cout << "Espresso minimization complete!\n";
-    } else {
-        for (int i = 0; i < numOutputs; i++) {
-            fout << "# Output function " << (outputLabels.empty() ? to_string(i) : outputLabels[i]) << "\n";
-            vector<Term> essentialPIs = runQuine(allMinterms[i], allDontCares[i]);
-            string sop = termsToSOP(essentialPIs, numVars);
-            fout << sop << "\n\n";
-        }
-        cout << "Minimization done! Check output.txt\n";
+    MinimizeResult result;
+    try {
+        result = Minimizer(options).minimize(pla);
+    } catch (const invalid_argument& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
+    if (!writeResult(outputFile, format, pla, result)) {
+        cerr << "Error writing output file\n";
+        return 1;
     }
+    cout << "Minimization done! Check " << outputFile << "\n";
 
-    fout.close();
+#ifdef QELM_PROFILE
+    // Phase timings go next to the report
+    string profileFile = outputFile.substr(0, outputFile.find_last_of('/') + 1) + "profile.json";
+    if (writeProfileReport(profileFile)) cout << "Profile written to " << profileFile << "\n";
+#endif
     return 0;
 }
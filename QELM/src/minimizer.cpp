@@ -0,0 +1,444 @@
+#include "minimizer.hpp"
+#include "quine.hpp"
+#include "espresso.hpp"
+#include "bdd.hpp"
+#include "thread_pool.hpp"
+#include "budget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+// Cost model thresholds (measured on random covers, see chooseEngine)
+static const double QM_MAX_CARE_MINTERMS = 8192;
+static const size_t BDD_MIN_CUBES = 1000;
+static const double BDD_MIN_FILL = 0.9;         // average literals per cube / numVars
+static const int BDD_MAX_VARS = 24;
+
+// A BDD node costs its entry in the node table, its unique-table slots and
+// its share of the ISOP memo
+static const size_t BDD_NODE_BYTES = 32;
+
+const char* engineName(Engine engine) {
+    switch (engine) {
+        case Engine::Auto: return "auto";
+        case Engine::Quine: return "quine";
+        case Engine::Espresso: return "espresso";
+        case Engine::Bdd: return "bdd";
+    }
+    return "auto";
+}
+
+bool parseEngine(const string& name, Engine& engine) {
+    for (Engine e : {Engine::Auto, Engine::Quine, Engine::Espresso, Engine::Bdd}) {
+        if (name == engineName(e)) {
+            engine = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+Minimizer::Minimizer(const MinimizerOptions& options) : options(options) {
+    if (!options.cacheDirectory.empty()) {
+        cache = make_shared<ResultCache>(options.cacheDirectory, options.cacheMaxBytes);
+    }
+}
+
+// Cache flag bits
+static const uint8_t CACHED_PROVEN_MINIMAL = 1;
+static const uint8_t CACHED_BDD_FELL_BACK = 2;
+
+static CachedCover toCached(const OutputCover& out) {
+    CachedCover c;
+    c.cover = out.cover;
+    c.engine = static_cast<uint8_t>(out.engine);
+    c.flags = (out.provenMinimal ? CACHED_PROVEN_MINIMAL : 0) | (out.bddFellBack ? CACHED_BDD_FELL_BACK : 0);
+    return c;
+}
+
+static OutputCover fromCached(const CachedCover& c) {
+    OutputCover out;
+    out.cover = c.cover;
+    out.engine = static_cast<Engine>(c.engine);
+    out.provenMinimal = c.flags & CACHED_PROVEN_MINIMAL;
+    out.bddFellBack = c.flags & CACHED_BDD_FELL_BACK;
+    out.fromCache = true;
+    return out;
+}
+
+// Thread count is left out: every engine gives the same cover for any count
+string Minimizer::cacheTag(Engine engine) const {
+    return string(engineName(engine)) + " passes=" + to_string(options.passes) + " seed=" + to_string(options.seed) +
+           " budget=" + to_string(options.timeBudgetSeconds);
+}
+
+static size_t countProductTerms(const vector<OutputCover>& outputs) {
+    set<Cube> distinct;
+    for (const OutputCover& out : outputs) {
+        for (const Term& t : out.cover) distinct.insert(t.getCube());
+    }
+    return distinct.size();
+}
+
+static int resolveThreads(int numThreads) {
+    if (numThreads > 0) return numThreads;
+    return static_cast<int>(max(1u, thread::hardware_concurrency()));
+}
+
+Engine Minimizer::chooseEngine(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars) {
+    // Minterms of a cube: 2^(free variables); overlaps are counted twice, which
+    // only makes the estimate cautious
+    double careMinterms = 0;
+    double literals = 0;
+    for (const vector<Term>* set : {&onSet, &dcSet}) {
+        for (const Term& t : *set) {
+            int lits = t.countLiterals();
+            careMinterms += ldexp(1.0, numVars - lits);
+            literals += lits;
+        }
+    }
+
+    if (numVars <= 31 && careMinterms <= QM_MAX_CARE_MINTERMS) return Engine::Quine;
+
+    size_t cubes = onSet.size() + dcSet.size();
+    double fill = cubes == 0 || numVars == 0 ? 0 : literals / (static_cast<double>(cubes) * numVars);
+    if (numVars <= BDD_MAX_VARS && cubes >= BDD_MIN_CUBES && fill >= BDD_MIN_FILL) return Engine::Bdd;
+
+    return Engine::Espresso;
+}
+
+OutputCover Minimizer::run(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars,
+                           Engine engine, int numThreads, size_t memoryBudget) const {
+    if (engine == Engine::Auto) engine = chooseEngine(onSet, dcSet, numVars);
+    if (!cache) return compute(onSet, dcSet, numVars, engine, numThreads, memoryBudget);
+
+    CacheKeyBuilder key;
+    key.addFunction(onSet, dcSet, numVars);
+    key.addTag(cacheTag(engine));
+    vector<CachedCover> cached;
+    if (cache->lookup(key.key(), numVars, cached) && cached.size() == 1) return fromCached(cached[0]);
+
+    // A cover degraded by the memory budget or cut short is not the one this key stands for
+    OutputCover result = compute(onSet, dcSet, numVars, engine, numThreads, memoryBudget);
+    if (!result.memoryFellBack && !result.cancelled) cache->store(key.key(), numVars, {toCached(result)});
+    return result;
+}
+
+// The input cubes as a cover: valid, if unminimized
+static vector<Term> uniqueCubes(const vector<Term>& onSet) {
+    vector<Term> cover = onSet;
+    sort(cover.begin(), cover.end());
+    cover.erase(unique(cover.begin(), cover.end()), cover.end());
+    return cover;
+}
+
+OutputCover Minimizer::compute(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars,
+                               Engine engine, int numThreads, size_t memoryBudget) const {
+    OutputCover result;
+    result.engine = engine;
+
+    // Nothing started after the token fired: the input cubes are the cover
+    // found so far, and skipping even the OFF-set keeps the remaining outputs quick
+    if (cancelRequested(options.cancel)) {
+        result.cancelled = true;
+        result.cover = uniqueCubes(onSet);
+        return result;
+    }
+
+    EspressoOptions espresso;
+    espresso.passes = options.passes;
+    espresso.seed = options.seed;
+    espresso.numThreads = numThreads;
+    espresso.timeLimitSeconds = options.timeBudgetSeconds;
+    espresso.memoryBudgetBytes = memoryBudget;
+    espresso.cancel = options.cancel;
+
+    BddOptions bdd;
+    if (memoryBudget > 0) bdd.nodeLimit = min(bdd.nodeLimit, max<size_t>(2, memoryBudget / BDD_NODE_BYTES));
+
+    // An engine over the memory budget gives way to one not tried yet: QM to
+    // Espresso, Espresso (whose OFF-set is the big table) to BDD, which has no
+    // OFF-set, and BDD to Espresso. When Espresso and BDD have both failed, the
+    // input cubes are a valid cover as they are.
+    bool espressoTried = false, bddTried = false;
+    while (true) {
+        try {
+            if (result.engine == Engine::Quine) {
+                // The prime chart is indexed by decimal minterms
+                if (numVars > 31) throw invalid_argument("the quine engine handles at most 31 variables");
+                CoverOptions cover;
+                cover.timeLimitSeconds = options.timeBudgetSeconds;
+                cover.cancel = options.cancel;
+                result.cover = runQuine(onSet, dcSet, numThreads, cover, &result.provenMinimal, nullptr, memoryBudget);
+            } else if (result.engine == Engine::Bdd) {
+                bddTried = true;
+                try {
+                    result.cover = runBddMinimize(onSet, dcSet, numVars, bdd);
+                } catch (const length_error&) {
+                    if (bdd.nodeLimit < BddOptions().nodeLimit) throw MemoryBudgetExceeded("BDD nodes");
+                    result.bddFellBack = true;
+                    result.engine = Engine::Espresso;
+                    espressoTried = true;
+                    result.cover = runEspressoMultiple(onSet, dcSet, numVars, espresso);
+                }
+            } else {
+                espressoTried = true;
+                result.cover = runEspressoMultiple(onSet, dcSet, numVars, espresso);
+            }
+            // A proven-minimal QM cover finished before the token fired
+            result.cancelled = cancelRequested(options.cancel) && !result.provenMinimal;
+            return result;
+        } catch (const MemoryBudgetExceeded&) {
+            result.memoryFellBack = true;
+            result.provenMinimal = false;
+            if (!espressoTried) {
+                result.engine = Engine::Espresso;
+            } else if (!bddTried) {
+                result.engine = Engine::Bdd;
+            } else {
+                result.inputKept = true;
+                result.cover = uniqueCubes(onSet);
+                return result;
+            }
+        }
+    }
+}
+
+OutputCover Minimizer::minimizeFunction(const vector<Term>& onSet, const vector<Term>& dcSet, int numVars) const {
+    return run(onSet, dcSet, numVars, options.engine, resolveThreads(options.numThreads), options.memoryBudgetBytes);
+}
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Outputs running at the same time split the memory budget
+static size_t budgetPerWorker(size_t budget, int workers) {
+    if (budget == 0) return 0;
+    return max<size_t>(budget / max(1, workers), 1);
+}
+
+Minimizer::Plan Minimizer::plan(const PLAFile& pla) const {
+    int numOutputs = pla.numOutputs;
+    Plan p;
+    p.onSets = splitByOutput(pla.onRows, numOutputs);
+    p.dcSets = splitByOutput(pla.dcRows, numOutputs);
+    p.engines.assign(numOutputs, options.engine);
+    for (int i = 0; i < numOutputs; i++) {
+        if (p.engines[i] == Engine::Auto) p.engines[i] = chooseEngine(p.onSets[i], p.dcSets[i], pla.numVars);
+    }
+    // All outputs on Espresso: minimize them together so shared product terms are found once
+    bool allEspresso = all_of(p.engines.begin(), p.engines.end(), [](Engine e) { return e == Engine::Espresso; });
+    p.shared = allEspresso && options.shareOutputs && numOutputs > 1;
+    return p;
+}
+
+bool Minimizer::minimizeShared(const PLAFile& pla, const Plan& p, int numThreads, size_t memoryBudget,
+                               MinimizeResult& result) const {
+    int numOutputs = pla.numOutputs;
+    auto start = chrono::steady_clock::now();
+    result.outputs.assign(numOutputs, OutputCover());
+
+    // The shared covers depend on every output, so the whole PLA is one entry
+    CacheKeyBuilder key;
+    if (cache) {
+        for (int i = 0; i < numOutputs; i++) key.addFunction(p.onSets[i], p.dcSets[i], pla.numVars);
+        key.addTag("shared " + cacheTag(Engine::Espresso));
+        vector<CachedCover> cached;
+        if (cache->lookup(key.key(), pla.numVars, cached) && static_cast<int>(cached.size()) == numOutputs) {
+            for (int i = 0; i < numOutputs; i++) result.outputs[i] = fromCached(cached[i]);
+            result.productTerms = countProductTerms(result.outputs);
+            result.shared = true;
+            result.engineSeconds += secondsSince(start);
+            return true;
+        }
+    }
+
+    EspressoOptions espresso;
+    espresso.passes = options.passes;
+    espresso.seed = options.seed;
+    espresso.numThreads = numThreads;
+    espresso.timeLimitSeconds = options.timeBudgetSeconds;
+
+    espresso.memoryBudgetBytes = memoryBudget;
+    espresso.cancel = options.cancel;
+
+    // Over the memory budget the outputs go on one by one, each with its own
+    // OFF-set and its own way down to cheaper engines
+    try {
+        vector<PLACube> shared = runEspressoMultiOutput(pla.onRows, pla.dcRows, pla.numVars, numOutputs, espresso);
+        vector<vector<PLACube>> perOutput = groupByOutput(shared, numOutputs);
+        bool cancelled = cancelRequested(options.cancel);
+        for (int i = 0; i < numOutputs; i++) {
+            result.outputs[i].engine = Engine::Espresso;
+            result.outputs[i].cancelled = cancelled;
+            for (const PLACube& c : perOutput[i]) result.outputs[i].cover.push_back(c.term);
+        }
+        result.productTerms = shared.size();
+        result.shared = true;
+
+        if (cache && !cancelled) {
+            vector<CachedCover> entry;
+            for (const OutputCover& out : result.outputs) entry.push_back(toCached(out));
+            cache->store(key.key(), pla.numVars, entry);
+        }
+        result.engineSeconds += secondsSince(start);
+        return true;
+    } catch (const MemoryBudgetExceeded&) {
+        result.sharingDropped = true;
+        result.engineSeconds += secondsSince(start);
+        return false;
+    }
+}
+
+MinimizeResult Minimizer::minimize(const PLAFile& pla) const {
+    int numOutputs = pla.numOutputs;
+    Plan p = plan(pla);
+
+    MinimizeResult result;
+    result.outputs.resize(numOutputs);
+    int hwThreads = resolveThreads(options.numThreads);
+    if (p.shared && minimizeShared(pla, p, hwThreads, options.memoryBudgetBytes, result)) return result;
+
+    // Outputs are independent and vary wildly in size, so each one is a task on a
+    // work-stealing pool. Threads left over when there are fewer outputs than
+    // cores go to the minimizers themselves.
+    int workers = max(1, min(hwThreads, numOutputs));
+    ThreadPool pool(workers);
+    int innerThreads = max(1, hwThreads / max(1, numOutputs));
+    size_t memoryBudget = budgetPerWorker(options.memoryBudgetBytes, workers);
+
+    vector<double> seconds(numOutputs);
+    vector<future<OutputCover>> tasks;
+    for (int i = 0; i < numOutputs; i++) {
+        tasks.push_back(pool.submit([&, i]() {
+            auto start = chrono::steady_clock::now();
+            OutputCover out = run(p.onSets[i], p.dcSets[i], pla.numVars, p.engines[i], innerThreads, memoryBudget);
+            seconds[i] = secondsSince(start);
+            return out;
+        }));
+    }
+
+    for (int i = 0; i < numOutputs; i++) {
+        result.outputs[i] = tasks[i].get();
+        result.engineSeconds += seconds[i];
+    }
+    result.productTerms = countProductTerms(result.outputs);
+    return result;
+}
+
+// State shared by the tasks of one minimizeAsync call
+struct AsyncJob {
+    shared_ptr<const PLAFile> pla;
+    Minimizer::AsyncDone done;
+    MinimizeResult result;
+    vector<double> seconds;     // per output task
+    atomic<int> remaining{0};
+    mutex errorMutex;
+    exception_ptr error;    // the first exception an output threw
+};
+
+// Called by the task that finishes the last output
+static void finishJob(AsyncJob& job) {
+    job.result.productTerms = countProductTerms(job.result.outputs);
+    for (double t : job.seconds) job.result.engineSeconds += t;
+    job.done(move(job.result), job.error);
+}
+
+void Minimizer::minimizeAsync(shared_ptr<const PLAFile> pla, ThreadPool& pool, AsyncDone done) const {
+    auto job = make_shared<AsyncJob>();
+    job->pla = pla;
+    job->done = move(done);
+    job->result.outputs.resize(pla->numOutputs);
+    job->seconds.resize(pla->numOutputs);
+    auto p = make_shared<const Plan>(plan(*pla));
+    size_t memoryBudget = budgetPerWorker(options.memoryBudgetBytes, pool.size());
+
+    // Every task is single-threaded: the parallelism is the pool's
+    auto queueOutputs = [this, job, p, memoryBudget, &pool]() {
+        job->remaining = job->pla->numOutputs;
+        for (int i = 0; i < job->pla->numOutputs; i++) {
+            pool.submit([this, job, p, memoryBudget, i]() {
+                auto start = chrono::steady_clock::now();
+                try {
+                    job->result.outputs[i] = run(p->onSets[i], p->dcSets[i], job->pla->numVars, p->engines[i], 1,
+                                                 memoryBudget);
+                } catch (...) {
+                    lock_guard<mutex> lock(job->errorMutex);
+                    if (!job->error) job->error = current_exception();
+                }
+                job->seconds[i] = secondsSince(start);
+                if (--job->remaining == 0) finishJob(*job);
+            });
+        }
+    };
+
+    if (pla->numOutputs == 0) {
+        job->done(move(job->result), nullptr);
+    } else if (p->shared) {
+        pool.submit([this, job, p, memoryBudget, queueOutputs]() {
+            try {
+                if (minimizeShared(*job->pla, *p, 1, memoryBudget, job->result)) {
+                    job->done(move(job->result), nullptr);
+                    return;
+                }
+            } catch (...) {
+                job->done(move(job->result), current_exception());
+                return;
+            }
+            queueOutputs();
+        });
+    } else {
+        queueOutputs();
+    }
+}
+
+MinimizeResult Minimizer::update(const MinimizeResult& previous, const PLAFile& pla, const PLADelta& delta) const {
+    int numOutputs = pla.numOutputs;
+    if (static_cast<int>(previous.outputs.size()) != numOutputs) return minimize(pla);
+    // Covers built for another input count cannot be patched
+    for (const OutputCover& out : previous.outputs) {
+        for (const Term& t : out.cover) {
+            if (t.getNumVars() != pla.numVars) return minimize(pla);
+        }
+    }
+
+    vector<vector<Term>> allMinterms = splitByOutput(pla.onRows, numOutputs);
+    vector<vector<Term>> allDontCares = splitByOutput(pla.dcRows, numOutputs);
+    vector<vector<Term>> addedOn = splitByOutput(delta.addedOn, numOutputs);
+    vector<vector<Term>> removedOn = splitByOutput(delta.removedOn, numOutputs);
+    vector<vector<Term>> addedDc = splitByOutput(delta.addedDc, numOutputs);
+    vector<vector<Term>> removedDc = splitByOutput(delta.removedDc, numOutputs);
+
+    MinimizeResult result = previous;
+    result.shared = false;
+    for (int i = 0; i < numOutputs; i++) {
+        CoverDelta d;
+        d.addedOn = addedOn[i];
+        d.removedOn = removedOn[i];
+        d.addedDc = addedDc[i];
+        d.removedDc = removedDc[i];
+        if (d.addedOn.empty() && d.removedOn.empty() && d.addedDc.empty() && d.removedDc.empty()) continue;
+
+        OutputCover& out = result.outputs[i];
+        // The cover is now updateCover's (Espresso's operators), whatever produced it before
+        out.cover = updateCover(out.cover, allMinterms[i], allDontCares[i], d, pla.numVars);
+        out.engine = Engine::Espresso;
+        out.provenMinimal = false;
+        out.bddFellBack = false;
+        out.fromCache = false;
+        out.memoryFellBack = false;
+        out.inputKept = false;
+        out.cancelled = false;
+    }
+    result.productTerms = countProductTerms(result.outputs);
+    return result;
+}
@@ -0,0 +1,284 @@
+#include "pla.hpp"
+#include "cubeops.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Read-only memory map of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const string& filename) {
+        fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) != 0) return;
+        length = static_cast<size_t>(st.st_size);
+        if (length == 0) {
+            valid = true;
+            return;
+        }
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) return;
+        madvise(p, length, MADV_SEQUENTIAL);
+        ptr = static_cast<const char*>(p);
+        valid = true;
+    }
+    ~MappedFile() {
+        if (ptr) munmap(const_cast<char*>(ptr), length);
+        if (fd >= 0) close(fd);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const { return valid; }
+    const char* begin() const { return ptr; }
+    const char* end() const { return ptr + length; }
+
+private:
+    int fd = -1;
+    const char* ptr = nullptr;
+    size_t length = 0;
+    bool valid = false;
+};
+
+static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Next whitespace-separated token of [p, end); false when the line is exhausted
+static bool nextToken(const char*& p, const char* end, const char*& tok, size_t& len) {
+    while (p < end && isBlank(*p)) p++;
+    if (p == end) return false;
+    tok = p;
+    while (p < end && !isBlank(*p)) p++;
+    len = static_cast<size_t>(p - tok);
+    return true;
+}
+
+static bool parseCount(const char* tok, size_t len, long& value) {
+    if (len == 0) return false;
+    value = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (tok[i] < '0' || tok[i] > '9') return false;
+        value = value * 10 + (tok[i] - '0');
+        if (value > (1L << 30)) return false;
+    }
+    return true;
+}
+
+static bool keywordIs(const char* tok, size_t len, const char* keyword) {
+    return len == strlen(keyword) && memcmp(tok, keyword, len) == 0;
+}
+
+static vector<string> readLabels(const char* p, const char* end) {
+    vector<string> labels;
+    const char* tok;
+    size_t len;
+    while (nextToken(p, end, tok, len)) labels.emplace_back(tok, len);
+    return labels;
+}
+
+// fr / fdr: whatever an output leaves unspecified is a don't-care
+static void addImpliedDontCares(PLAFile& pla) {
+    vector<vector<Term>> on = splitByOutput(pla.onRows, pla.numOutputs);
+    vector<vector<Term>> dc = splitByOutput(pla.dcRows, pla.numOutputs);
+    vector<vector<Term>> off = splitByOutput(pla.offRows, pla.numOutputs);
+
+    for (int k = 0; k < pla.numOutputs; k++) {
+        vector<Cube> specified;
+        for (const Term& t : on[k]) specified.push_back(t.getCube());
+        for (const Term& t : dc[k]) specified.push_back(t.getCube());
+        for (const Term& t : off[k]) specified.push_back(t.getCube());
+
+        OutputMask only;
+        only.set(k);
+        for (const Cube& c : complement(specified, pla.numVars)) {
+            pla.dcRows.push_back(PLACube(Term(c, pla.numVars), only));
+        }
+    }
+}
+
+bool parsePLA(const string& filename, PLAFile& pla) {
+    MappedFile file(filename);
+    if (!file.ok()) {
+        cerr << "Error opening input file " << filename << "\n";
+        return false;
+    }
+
+    pla = PLAFile();
+    bool seenInputs = false;
+    size_t lineNo = 0;
+    size_t rowsRead = 0;
+
+    const char* p = file.begin();
+    const char* fileEnd = file.end();
+    while (p < fileEnd) {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(fileEnd - p)));
+        if (!lineEnd) lineEnd = fileEnd;
+        const char* cur = p;
+        p = lineEnd + (lineEnd < fileEnd ? 1 : 0);
+        lineNo++;
+
+        const char* tok;
+        size_t len;
+        if (!nextToken(cur, lineEnd, tok, len) || tok[0] == '#') continue;
+
+        if (tok[0] == '.') {
+            long value;
+            if (keywordIs(tok, len, ".e") || keywordIs(tok, len, ".end")) {
+                break;
+            } else if (keywordIs(tok, len, ".i") || keywordIs(tok, len, ".o") || keywordIs(tok, len, ".p")) {
+                char which = tok[1];
+                if (!nextToken(cur, lineEnd, tok, len) || !parseCount(tok, len, value)) {
+                    cerr << "Line " << lineNo << ": bad ." << which << " count\n";
+                    return false;
+                }
+                if (which == 'i') {
+                    if (value > Cube::MAX_VARS) {
+                        cerr << "Line " << lineNo << ": more than " << Cube::MAX_VARS << " inputs\n";
+                        return false;
+                    }
+                    pla.numVars = static_cast<int>(value);
+                    seenInputs = true;
+                } else if (which == 'o') {
+                    if (value < 1 || value > Cube::MAX_VARS) {
+                        cerr << "Line " << lineNo << ": unsupported output count\n";
+                        return false;
+                    }
+                    pla.numOutputs = static_cast<int>(value);
+                } else {
+                    pla.declaredProducts = static_cast<size_t>(value);
+                    // .p is only a hint: reserve no more rows than the rest of the file can hold
+                    size_t rowBytes = static_cast<size_t>(pla.numVars + pla.numOutputs + 2);
+                    pla.onRows.reserve(min(pla.declaredProducts, static_cast<size_t>(fileEnd - p) / rowBytes));
+                }
+            } else if (keywordIs(tok, len, ".ilb")) {
+                pla.inputLabels = readLabels(cur, lineEnd);
+            } else if (keywordIs(tok, len, ".ob")) {
+                pla.outputLabels = readLabels(cur, lineEnd);
+            } else if (keywordIs(tok, len, ".type")) {
+                if (!nextToken(cur, lineEnd, tok, len) ||
+                    !(keywordIs(tok, len, "f") || keywordIs(tok, len, "fd") ||
+                      keywordIs(tok, len, "fr") || keywordIs(tok, len, "fdr"))) {
+                    cerr << "Line " << lineNo << ": unsupported .type\n";
+                    return false;
+                }
+                pla.type.assign(tok, len);
+            }
+            // Other directives (.phase, .pair, ...) do not change the function
+            continue;
+        }
+
+        if (!seenInputs) {
+            cerr << "Line " << lineNo << ": cube row before .i\n";
+            return false;
+        }
+
+        // Input part straight into a packed cube
+        if (len != static_cast<size_t>(pla.numVars)) {
+            cerr << "Line " << lineNo << ": expected " << pla.numVars << " inputs\n";
+            return false;
+        }
+        Cube cube;
+        for (size_t j = 0; j < len; j++) {
+            char c = tok[j];
+            if (c == '0' || c == '1') cube.setLiteral(static_cast<int>(j), c);
+            else if (c != '-' && c != '2') {
+                cerr << "Line " << lineNo << ": bad input character '" << c << "'\n";
+                return false;
+            }
+        }
+
+        // Output part: 1/4 = on, -/2 = dc, 0 = off, ~ = not specified
+        if (!nextToken(cur, lineEnd, tok, len) || len != static_cast<size_t>(pla.numOutputs)) {
+            cerr << "Line " << lineNo << ": expected " << pla.numOutputs << " outputs\n";
+            return false;
+        }
+        OutputMask on, dc, off;
+        for (size_t k = 0; k < len; k++) {
+            char c = tok[k];
+            if (c == '1' || c == '4') on.set(static_cast<int>(k));
+            else if (c == '-' || c == '2') dc.set(static_cast<int>(k));
+            else if (c == '0') off.set(static_cast<int>(k));
+            else if (c != '~') {
+                cerr << "Line " << lineNo << ": bad output character '" << c << "'\n";
+                return false;
+            }
+        }
+
+        bool hasDc = pla.type.find('d') != string::npos;
+        bool hasOff = pla.type.find('r') != string::npos;
+        rowsRead++;
+        Term row(cube, pla.numVars);
+        if (on.any()) pla.onRows.emplace_back(row, on);
+        if (hasDc && dc.any()) pla.dcRows.emplace_back(row, dc);
+        if (hasOff && off.any()) pla.offRows.emplace_back(row, off);
+    }
+
+    if (!seenInputs) {
+        cerr << "Missing .i in " << filename << "\n";
+        return false;
+    }
+    if (pla.declaredProducts > 0 && pla.declaredProducts != rowsRead) {
+        cerr << "Warning: .p declares " << pla.declaredProducts << " rows, " << filename << " has " << rowsRead << "\n";
+    }
+    if (pla.type.find('r') != string::npos) {
+        addImpliedDontCares(pla);
+    }
+    return true;
+}
+
+vector<vector<Term>> splitByOutput(const vector<PLACube>& rows, int numOutputs) {
+    vector<vector<Term>> grouped(numOutputs);
+    for (const PLACube& row : rows) {
+        for (int w = 0; w < Cube::WORDS; w++) {
+            uint64_t bits = row.outputs.bits[w];
+            while (bits) {
+                int k = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                if (k < numOutputs) grouped[k].push_back(row.term);
+            }
+        }
+    }
+    return grouped;
+}
+
+// (input cube, output) -> how many more times it appears in after than in before
+typedef map<pair<Cube, int>, long> RowCounts;
+
+static void countRows(const vector<PLACube>& rows, int numOutputs, long sign, RowCounts& counts) {
+    vector<vector<Term>> grouped = splitByOutput(rows, numOutputs);
+    for (int k = 0; k < numOutputs; k++) {
+        for (const Term& t : grouped[k]) counts[{t.getCube(), k}] += sign;
+    }
+}
+
+static void collectChanges(const RowCounts& counts, int numVars, vector<PLACube>& added, vector<PLACube>& removed) {
+    for (const auto& [row, n] : counts) {
+        OutputMask mask;
+        mask.set(row.second);
+        PLACube cube(Term(row.first, numVars), mask);
+        for (long i = 0; i < n; i++) added.push_back(cube);
+        for (long i = 0; i < -n; i++) removed.push_back(cube);
+    }
+}
+
+PLADelta diffPLA(const PLAFile& before, const PLAFile& after) {
+    int numOutputs = max(before.numOutputs, after.numOutputs);
+    RowCounts on, dc;
+    countRows(before.onRows, numOutputs, -1, on);
+    countRows(after.onRows, numOutputs, 1, on);
+    countRows(before.dcRows, numOutputs, -1, dc);
+    countRows(after.dcRows, numOutputs, 1, dc);
+
+    PLADelta delta;
+    collectChanges(on, after.numVars, delta.addedOn, delta.removedOn);
+    collectChanges(dc, after.numVars, delta.addedDc, delta.removedDc);
+    return delta;
+}
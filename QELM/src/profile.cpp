@@ -0,0 +1,68 @@
+#include "profile.hpp"
+
+#ifdef QELM_PROFILE
+
+#include <atomic>
+#include <fstream>
+
+using namespace std;
+
+static const int NUM_PHASES = static_cast<int>(ProfilePhase::Count);
+static const int NUM_COUNTERS = static_cast<int>(ProfileCounter::Count);
+
+static const char* const phaseNames[NUM_PHASES] = {
+    "combine", "consensus", "chart", "cover_search", "complement", "expand", "irredundant", "reduce", "essential", "bdd"
+};
+static const char* const counterNames[NUM_COUNTERS] = {
+    "cubes_generated", "merges_attempted", "merges_succeeded", "set_insertions", "peak_cover_size"
+};
+
+// Relaxed atomics: each update is independent and the report is read after the run
+static atomic<uint64_t> phaseNanos[NUM_PHASES];
+static atomic<uint64_t> phaseCalls[NUM_PHASES];
+static atomic<uint64_t> counters[NUM_COUNTERS];
+
+ProfileScope::~ProfileScope() {
+    uint64_t ns = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now() - start).count());
+    int i = static_cast<int>(phase);
+    phaseNanos[i].fetch_add(ns, memory_order_relaxed);
+    phaseCalls[i].fetch_add(1, memory_order_relaxed);
+}
+
+void profileAdd(ProfileCounter counter, uint64_t n) {
+    counters[static_cast<int>(counter)].fetch_add(n, memory_order_relaxed);
+}
+
+void profileMax(ProfileCounter counter, uint64_t n) {
+    atomic<uint64_t>& slot = counters[static_cast<int>(counter)];
+    uint64_t seen = slot.load(memory_order_relaxed);
+    while (n > seen && !slot.compare_exchange_weak(seen, n, memory_order_relaxed)) {}
+}
+
+void resetProfile() {
+    for (int i = 0; i < NUM_PHASES; i++) {
+        phaseNanos[i] = 0;
+        phaseCalls[i] = 0;
+    }
+    for (int i = 0; i < NUM_COUNTERS; i++) counters[i] = 0;
+}
+
+bool writeProfileReport(const string& path) {
+    ofstream out(path);
+    if (!out) return false;
+
+    out << "{\n  \"phases\": {\n";
+    for (int i = 0; i < NUM_PHASES; i++) {
+        out << "    \"" << phaseNames[i] << "\": {\"calls\": " << phaseCalls[i].load()
+            << ", \"ms\": " << phaseNanos[i].load() / 1e6 << "}" << (i + 1 < NUM_PHASES ? "," : "") << "\n";
+    }
+    out << "  },\n  \"counters\": {\n";
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        out << "    \"" << counterNames[i] << "\": " << counters[i].load() << (i + 1 < NUM_COUNTERS ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+    return static_cast<bool>(out);
+}
+
+#endif
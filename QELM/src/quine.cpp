@@ -2,158 +2,265 @@
 #include "utils.hpp"
 #include "term.hpp"
 #include "combine.hpp"
+#include "cover.hpp"
+#include "cubeops.hpp"
+#include "cube_batch.hpp"
+#include "arena.hpp"
+#include "profile.hpp"
+#include "writer.hpp"
+#include "budget.hpp"
 
 #include <set>
 #include <vector>
 #include <map>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 
-//Quine McCluskey algorithm
-vector<Term> runQuine(const vector<Term>& minterms, const vector<Term>& dontCares) {
-    vector<Term> allTerms = minterms;
-    allTerms.insert(allTerms.end(), dontCares.begin(), dontCares.end());
+// Consensus pays off when the input cubes stand for many minterms each. Its
+// containment checks grow with the square of the cube count, so long covers
+// still go through the combining rounds.
+static const double CONSENSUS_MIN_MINTERMS_PER_CUBE = 8;
+static const size_t CONSENSUS_MAX_CUBES = 256;
 
-    vector<Term> current = allTerms;
-    vector<Term> nextRound;
-    vector<Term> primeImplicants;
+// Memory a term costs while the primes are generated (the term itself plus
+// its share of the combining hash tables), and a chart row as the row in the
+// minterm set and map plus its vector; each prime in a row adds an int
+static const size_t QM_TERM_BYTES = 2 * sizeof(Term) + 32;
+static const size_t QM_ROW_BYTES = 128;
 
-    //  Keep combining until no more combinations possible
-    while (true) {
-        nextRound = combineTerms(current);
+static bool preferConsensus(const vector<Term>& terms) {
+    if (terms.empty() || terms.size() > CONSENSUS_MAX_CUBES) return false;
+    double careMinterms = 0;
+    for (const Term& t : terms) careMinterms += ldexp(1.0, t.getNumVars() - t.countLiterals());
+    return careMinterms >= CONSENSUS_MIN_MINTERMS_PER_CUBE * terms.size();
+}
 
-        //  If nothing changed, we're done
-        if (nextRound.size() == current.size()) {
-            break;
-        }
+// Combining only merges cubes with the same free variables, so cubes are
+// split into their minterms first; duplicates from overlapping cubes go
+static vector<Term> toMinterms(const vector<Term>& terms, size_t memoryBudget, const CancelToken* cancel) {
+    bool allMinterms = true;
+    size_t count = 0;
+    for (const Term& t : terms) {
+        allMinterms &= t.countLiterals() == t.getNumVars();
+        count += t.getCoveredMinterms().size();
+    }
+    if (allMinterms) return terms;
+    checkMemoryBudget(memoryBudget, count, QM_TERM_BYTES, "the minterm list");
 
-        current = nextRound;
+    // Cancelled part way, the cubes themselves are the best list there is
+    vector<Term> minterms;
+    for (const Term& t : terms) {
+        if (cancelRequested(cancel)) return terms;
+        for (int m : t.getCoveredMinterms()) minterms.push_back(Term(m, t.getNumVars(), t.isDontCareTerm()));
     }
-    
+    sort(minterms.begin(), minterms.end());
+    minterms.erase(unique(minterms.begin(), minterms.end()), minterms.end());
+    return minterms;
+}
 
-    primeImplicants=nextRound;
-    //  Filter only those prime implicants that cover original minterms
+// Builds the prime chart, moves the essential primes into essentialPIs (their
+// indices into added) and returns the rows they leave uncovered: the cyclic core
+static vector<vector<int>> buildCoreRows(const vector<Term>& minterms, const vector<Term>& primeImplicants,
+                                         vector<Term>& essentialPIs, set<int>& added, size_t memoryBudget) {
     // some primeImplicants cover those minterms which are not needed as covered by other so filter those and left them
-    vector<Term> essentialPIs;
-    map<int, vector<Term>> chart;
-
-    for (const Term& t : primeImplicants) {
-        for (int m : t.getCoveredMinterms()) {
-            bool isCovered = false;
-
-            // Loop through original minterms to check if any of them cover 'm'
-            for (const Term& mt : minterms) {
-                if (mt.getCoveredMinterms().count(m)) {
-                    isCovered = true;
-                    break;
-                }
-            }
+    QELM_PROFILE_SCOPE(Chart);
+    map<int, vector<int>> chart;    // on-set minterm -> indices of the primes covering it
 
-            if (isCovered) {
-                chart[m].push_back(t);
-            }
+    // Rows are the on-set minterms; a prime goes in a row when its cube covers it
+    size_t rows = 0;
+    for (const Term& mt : minterms) rows += mt.getCoveredMinterms().size();
+    checkMemoryBudget(memoryBudget, rows, QM_ROW_BYTES, "the prime chart");
+    set<int> onMinterms;
+    for (const Term& mt : minterms) {
+        for (int m : mt.getCoveredMinterms()) {
+            onMinterms.insert(m);
         }
     }
 
-    set<Term> added;
+    if (primeImplicants.empty()) return {};
+    int numVars = primeImplicants[0].getNumVars();
+    vector<Cube> primeCubes;
+    for (const Term& p : primeImplicants) primeCubes.push_back(p.getCube());
+    CubeArray primes(primeCubes, numVars);
+    MatchMask covering;
+    size_t chartBytes = 0;
+    for (int m : onMinterms) {
+        matchContaining(Cube::fromMinterm(m, numVars), primes, covering);
+        vector<int>& row = chart[m];
+        forEachMatch(covering, [&](size_t i) { row.push_back(static_cast<int>(i)); });
+        chartBytes += QM_ROW_BYTES + row.size() * sizeof(int);
+        checkMemoryBudget(memoryBudget, chartBytes, 1, "the prime chart");
+    }
 
     for (auto it = chart.begin(); it != chart.end(); it++) {
-        const vector<Term>& terms = it->second;
+        const vector<int>& terms = it->second;
 
         if (terms.size() == 1) {
-            const Term& epi = terms[0];
+            int epi = terms[0];
 
             // Check if we’ve already added this essential prime implicant
             if (added.find(epi) == added.end()) {
-                essentialPIs.push_back(epi);
+                essentialPIs.push_back(primeImplicants[epi]);
                 added.insert(epi);
             }
         }
     }
-    
-    // Using Petrick's method
+
     // final answer is of the form F= EPI + P
-    // Where P is prime implicants so we need to find P
-    
+    // Where P is a minimum set of the remaining primes covering the cyclic core
+
     // Step 1: Identify uncovered minterms
-    set<int> covered;
-    for (const Term& epi : essentialPIs) {
-        for (int m : epi.getCoveredMinterms()) {
-            covered.insert(m);
+    vector<vector<int>> coreRows;
+    for (const auto& [m, terms] : chart) {
+        bool covered = false;
+        for (int i : terms) {
+            if (added.count(i)) {
+                covered = true;
+                break;
+            }
+        }
+        if (!covered) {
+            coreRows.push_back(terms);
         }
     }
 
-    set<int> uncovered;
-    for (const auto& [m, _] : chart) {
-        if (!covered.count(m)) {
-            uncovered.insert(m);
-        }
+    return coreRows;
+}
+
+// Past this many cube comparisons, a cancelled run keeps the input cubes
+// rather than spend much longer after its deadline looking for bigger ones
+static const double ANYTIME_MAX_COMPARISONS = 1 << 26;
+
+// Cover for a run cut short before the primes were complete: each on cube
+// goes to the implicant with the fewest literals that contains it, or stays
+// as it is when none does
+static vector<Term> coverFromImplicants(const vector<Term>& onSet, const vector<Term>& implicants) {
+    if (onSet.empty()) return {};
+    int numVars = onSet[0].getNumVars();
+    vector<Cube> cubes;
+    if (static_cast<double>(onSet.size()) * implicants.size() <= ANYTIME_MAX_COMPARISONS) {
+        for (const Term& t : implicants) cubes.push_back(t.getCube());
     }
-    
-    if(uncovered.size()==0){
-        return essentialPIs;
+    CubeArray candidates(cubes, numVars);
+
+    vector<Cube> chosen;
+    CubeArray picked(numVars);
+    MatchMask hits;
+    for (const Term& t : onSet) {
+        const Cube& c = t.getCube();
+        matchContaining(c, picked, hits);
+        if (any_of(hits.begin(), hits.end(), [](uint64_t w) { return w != 0; })) continue;
+        Cube best = c;
+        matchContaining(c, candidates, hits);
+        forEachMatch(hits, [&](size_t i) {
+            if (cubes[i].countLiterals() < best.countLiterals()) best = cubes[i];
+        });
+        chosen.push_back(best);
+        picked.push_back(best);
     }
 
-    // Step 2: Build Petrick expression
-    vector<set<set<int>>> petrickProduct;  // Each inner set is a term (product of implicants)
+    sort(chosen.begin(), chosen.end());
+    vector<Term> cover;
+    for (const Cube& c : chosen) cover.push_back(Term(c, numVars));
+    return cover;
+}
+
+//Quine McCluskey algorithm
+vector<Term> runQuine(const vector<Term>& minterms, const vector<Term>& dontCares, int numThreads,
+                      const CoverOptions& coverOptions, bool* provenOptimal, QuineStats* stats,
+                      size_t memoryBudget) {
+    // Every round's tables come from one arena, released when the function returns
+    ArenaScope scope("quine");
+    const CancelToken* cancel = coverOptions.cancel;
+
+    vector<Term> current = minterms;
+    current.insert(current.end(), dontCares.begin(), dontCares.end());
+    vector<Term> primeImplicants;
+    QuineStats counters;
 
-    map<Term, int> piToIndex;
-    vector<Term> piIndexList;
-    int index = 0;
-    for (const Term& pi : primeImplicants) {
-        if (piToIndex.find(pi) == piToIndex.end()) {
-            piToIndex[pi] = index++;
-            piIndexList.push_back(pi);
+    if (preferConsensus(current)) {
+        QELM_PROFILE_SCOPE(Consensus);
+        int numVars = current[0].getNumVars();
+        vector<Cube> cubes;
+        cubes.reserve(current.size());
+        for (const Term& t : current) cubes.push_back(t.getCube());
+        for (const Cube& c : allPrimes(cubes, numVars, budgetItems(memoryBudget, QM_TERM_BYTES), cancel)) {
+            primeImplicants.push_back(Term(c, numVars));
         }
-    }
+        counters.consensus = true;
+        counters.cancelled = cancelRequested(cancel);
+        QELM_PROFILE_MAX(PeakCoverSize, primeImplicants.size());
+    } else {
+        current = toMinterms(current, memoryBudget, cancel);
+        checkMemoryBudget(memoryBudget, current.size(), QM_TERM_BYTES, "the combining rounds");
+        vector<Term> nextRound;
+
+        //  Keep combining until no more combinations possible
+        while (true) {
+            if (cancelRequested(cancel)) {
+                counters.cancelled = true;
+                break;
+            }
+            nextRound = combineTerms(current, numThreads, cancel);
+            counters.rounds++;
+            // A round cut short hands back its input, so either way nextRound is usable
+            if (cancelRequested(cancel)) {
+                counters.cancelled = true;
+                current.swap(nextRound);
+                break;
+            }
+            QELM_PROFILE_MAX(PeakCoverSize, nextRound.size());
+            checkMemoryBudget(memoryBudget, current.size() + nextRound.size(), QM_TERM_BYTES, "the combining rounds");
 
-    for (int m : uncovered) {
-        set<set<int>> clause;
-        for (const Term& pi : chart[m]) {
-            clause.insert({ piToIndex[pi] });
+            //  If nothing changed, we're done (a round can merge terms and keep the same count)
+            if (nextRound == current) {
+                break;
+            }
+
+            current.swap(nextRound);
         }
-        petrickProduct.push_back(clause);
+
+        primeImplicants.swap(current);
     }
-    
 
-    // Step 3: Expand the product
-    
-    if (petrickProduct.empty()) {
-        return essentialPIs;  // Nothing to expand
+    counters.primes = primeImplicants.size();
+    if (counters.cancelled) {
+        if (provenOptimal) *provenOptimal = false;
+        if (stats) *stats = counters;
+        return coverFromImplicants(minterms, primeImplicants);
     }
-    
-    set<set<int>> petrickResult = petrickProduct[0];// error in this line
-    for (size_t i = 1; i < petrickProduct.size(); i++) {
-        set<set<int>> newResult;
-        for (const auto& a : petrickResult) {
-            for (const auto& b : petrickProduct[i]) {
-                set<int> merged = a;
-                merged.insert(b.begin(), b.end());
-                newResult.insert(merged);
-            }
-        }
-        petrickResult = newResult;
+
+    //  Filter only those prime implicants that cover original minterms
+    vector<Term> essentialPIs;
+    set<int> added;
+    vector<vector<int>> coreRows = buildCoreRows(minterms, primeImplicants, essentialPIs, added, memoryBudget);
+
+    counters.coreRows = coreRows.size();
+    if (coreRows.empty()) {
+        if (provenOptimal) *provenOptimal = true;
+        if (stats) *stats = counters;
+        return essentialPIs;
     }
 
-    // Step 4: Choose minimal term
-    size_t minSize = SIZE_MAX;
-    for (const auto& term : petrickResult) {
-        if (term.size() < minSize) {
-            minSize = term.size();
-        }
+    // Step 2: Solve the cyclic core as a unate covering problem.
+    // Fewer primes always wins; literals break ties.
+    vector<long long> costs(primeImplicants.size());
+    for (size_t i = 0; i < primeImplicants.size(); i++) {
+        costs[i] = (1LL << 32) + primeImplicants[i].countLiterals();
     }
 
-    for (const auto& term : petrickResult) {
-        if (term.size() == minSize) {
-            for (int i : term) {
-                const Term& selected = piIndexList[i];
-                if (added.find(selected) == added.end()) {
-                    essentialPIs.push_back(selected);
-                    added.insert(selected);
-                }
-            }
-            break;
+    CoverResult core = solveCover(coreRows, costs, coverOptions);
+    if (provenOptimal) *provenOptimal = core.optimal;
+    counters.coverNodes = core.nodes;
+    if (stats) *stats = counters;
+
+    for (int i : core.columns) {
+        if (added.find(i) == added.end()) {
+            essentialPIs.push_back(primeImplicants[i]);
+            added.insert(i);
         }
     }
 
@@ -162,27 +269,8 @@ vector<Term> runQuine(const vector<Term>& minterms, const vector<Term>& dontCare
     return essentialPIs;
 }
 
-string termsToSOP(const vector<Term>& terms, int numVars) {
+string termsToSOP(const vector<Term>& terms, int numVars, const vector<string>& labels) {
     string result;
-
-    for (size_t i = 0; i < terms.size(); i++) {
-        const string& bin = terms[i].getBinary();
-
-        for (int j = 0; j < numVars; j++) {
-            if (bin[j] == '-') continue;
-
-            char var = 'A' + j;
-            if (bin[j] == '0') {
-                result += var;
-                result += '\'';
-                
-            }else {
-                result += var;
-            }
-        }
-
-        if (i != terms.size() - 1) result += " + ";
-    }
-
+    appendSOP(result, terms, inputNames(numVars, labels));
     return result;
 }
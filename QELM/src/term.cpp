@@ -1,44 +1,37 @@
 #include "term.hpp"
-#include <bitset>
-#include <algorithm>
 
 using namespace std;
 
 // Constructor from decimal
 Term::Term(int decimal, int numVars, bool isDontCare) {
-    binary = bitset<32>(decimal).to_string().substr(32 - numVars);
-    coveredMinterms.insert(decimal);
+    cube = Cube::fromMinterm(decimal, numVars);
+    this->numVars = numVars;
     this->isDontCare = isDontCare;
 }
 
 // Constructor from binary string
-Term::Term(const string& binString, set<int> covered, bool isDontCare) {
-    binary = binString;
-    coveredMinterms = covered;
+Term::Term(const string& binString, bool isDontCare) {
+    cube = Cube::fromString(binString);
+    numVars = static_cast<int>(binString.size());
     this->isDontCare = isDontCare;
 }
 
-string Term::getBinary() const { return binary; }
-set<int> Term::getCoveredMinterms() const { return coveredMinterms; }
+// Constructor from an already packed cube
+Term::Term(const Cube& cube, int numVars, bool isDontCare) {
+    this->cube = cube;
+    this->numVars = numVars;
+    this->isDontCare = isDontCare;
+}
+
+string Term::getBinary() const { return cube.toString(numVars); }
+MintermRange Term::getCoveredMinterms() const { return MintermRange(cube, numVars); }
 bool Term::isUsed() const { return used; }
 bool Term::isDontCareTerm() const { return isDontCare; }
 void Term::markUsed() { used = true; }
 
 bool Term::canCombineWith(const Term& other) const {
-    string a = this->getBinary();
-    string b = other.getBinary();
-    
-    if (a.length() != b.length()) return false;
-    int diffCount = 0;
-
-    for (size_t i = 0; i < a.length(); i++) {
-        if (a[i] != b[i]) {
-            diffCount++;
-            if (diffCount > 1) return false;
-        }
-    }
-
-    return diffCount == 1;
+    if (numVars != other.numVars) return false;
+    return cube.isAdjacent(other.cube);
 }
 
 Term Term::combineWith(const Term& other) const {
@@ -46,49 +39,44 @@ Term Term::combineWith(const Term& other) const {
         throw "Error: minterm forced to be combined";
     }
 
-    string a = this->getBinary();
-    string b = other.getBinary();
-    string result = "";
-
-    for (size_t i = 0; i < a.length(); i++) {
-        if (a[i] == b[i]) {
-            result += a[i];
-        } else {
-            result += '-';
-        }
-    }
-
-    set<int> mergedMinterms = this->getCoveredMinterms();
-    for (int m : other.getCoveredMinterms()) {
-        mergedMinterms.insert(m);
-    }
-    
     if(countOnes()==0){
-        return Term(result,mergedMinterms,true);
+        return Term(cube.merge(other.cube), numVars, true);
     }
-    return Term(result, mergedMinterms);
+    return Term(cube.merge(other.cube), numVars);
 }
 
 int Term::countOnes() const {
-    int count = 0;
-    for (char bit : getBinary()) {
-        if (bit == '1') count++;
-    }
-    return count;
+    return cube.countOnes();
+}
+
+int Term::countLiterals() const {
+    return cube.countLiterals();
+}
+
+bool Term::coversMinterm(int decimal) const {
+    return cube.containsMinterm(decimal, numVars);
+}
+
+bool Term::contains(const Term& other) const {
+    return numVars == other.numVars && cube.contains(other.cube);
+}
+
+bool Term::intersects(const Term& other) const {
+    return numVars == other.numVars && cube.intersects(other.cube);
 }
 
 bool Term::operator==(const Term& other) const {
-    return binary == other.binary &&
-           coveredMinterms == other.coveredMinterms &&
+    return numVars == other.numVars &&
+           cube == other.cube &&
            isDontCare == other.isDontCare;
 }
 
 bool Term::operator<(const Term& other) const {
-    if (binary != other.binary) {
-        return binary < other.binary;
+    if (numVars != other.numVars) {
+        return numVars < other.numVars;
     }
-    if (coveredMinterms != other.coveredMinterms) {
-        return coveredMinterms < other.coveredMinterms;
+    if (cube != other.cube) {
+        return cube < other.cube;
     }
     return isDontCare < other.isDontCare;
 }
@@ -0,0 +1,84 @@
+#include "thread_pool.hpp"
+
+using namespace std;
+
+// Which pool and deque the calling thread works for, if any
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local int currentWorker = -1;
+
+ThreadPool::ThreadPool(int numThreads, function<void()> workerInit) : workerInit(move(workerInit)) {
+    if (numThreads <= 0) numThreads = static_cast<int>(max(1u, thread::hardware_concurrency()));
+    for (int i = 0; i < numThreads; i++) {
+        queues.push_back(make_unique<WorkerQueue>());
+    }
+    for (int i = 0; i < numThreads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (thread& t : workers) t.join();
+}
+
+void ThreadPool::push(function<void()> task) {
+    size_t target = (currentPool == this) ? static_cast<size_t>(currentWorker)
+                                          : nextQueue++ % queues.size();
+    // Count the task before it becomes visible so a thief can never take pending below zero
+    {
+        lock_guard<std::mutex> lock(sleepMutex);
+        pending++;
+    }
+    {
+        lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    ready.notify_one();
+}
+
+// Own deque from the back, then steal from the front of the others
+bool ThreadPool::pop(int self, function<void()>& task) {
+    {
+        WorkerQueue& own = *queues[self];
+        lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending--;
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); k++) {
+        WorkerQueue& victim = *queues[(self + k) % queues.size()];
+        lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int self) {
+    currentPool = this;
+    currentWorker = self;
+    if (workerInit) workerInit();
+
+    function<void()> task;
+    while (true) {
+        if (pop(self, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        unique_lock<std::mutex> lock(sleepMutex);
+        ready.wait(lock, [this] { return stopping || pending > 0; });
+        if (stopping && pending == 0) return;
+    }
+}
@@ -15,12 +15,7 @@ map<int, vector<Term>> groupByOnes(const vector<Term>& terms) {
 int countLiterals(const vector<Term>& terms) {
     int total = 0;
     for (const Term& t : terms) {
-        string bin = t.getBinary();
-        for (char c : bin) {
-            if (c != '-') {
-                total++;
-            }
-        }
+        total += t.countLiterals();
     }
     return total;
 }
@@ -0,0 +1,311 @@
+#include "writer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char MAGIC[8] = {'Q', 'E', 'L', 'M', 'C', 'B', '1', '\n'};
+
+FileWriter::FileWriter(const string& path) : buffer(size_t(1) << 16) {
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+FileWriter::~FileWriter() { close(); }
+
+void FileWriter::flush() {
+    const char* p = buffer.data();
+    size_t left = used;
+    while (left > 0 && !failed) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            failed = true;
+            break;
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    used = 0;
+}
+
+void FileWriter::append(const char* text, size_t length) {
+    while (length > 0) {
+        if (used == buffer.size()) flush();
+        size_t n = min(length, buffer.size() - used);
+        memcpy(buffer.data() + used, text, n);
+        used += n;
+        text += n;
+        length -= n;
+    }
+}
+
+void FileWriter::appendNumber(uint64_t n) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + n % 10);
+        n /= 10;
+    } while (n);
+    while (count > 0) push_back(digits[--count]);
+}
+
+void FileWriter::appendLittleEndian(uint64_t word, int bytes) {
+    char data[8];
+    for (int i = 0; i < bytes; i++) data[i] = static_cast<char>((word >> (8 * i)) & 0xff);
+    append(data, bytes);
+}
+
+bool FileWriter::close() {
+    if (fd < 0) return false;
+    flush();
+    if (::close(fd) != 0) failed = true;
+    fd = -1;
+    return !failed;
+}
+
+vector<string> inputNames(int numVars, const vector<string>& labels) {
+    if (static_cast<int>(labels.size()) == numVars) return labels;
+    vector<string> names(numVars);
+    for (int j = 0; j < numVars; j++) names[j] = numVars <= 26 ? string(1, static_cast<char>('A' + j)) : "x" + to_string(j);
+    return names;
+}
+
+bool writeReport(const string& path, const PLAFile& pla, const MinimizeResult& result) {
+    FileWriter out(path);
+    if (!out.ok()) return false;
+
+    vector<string> names = inputNames(pla.numVars, pla.inputLabels);
+    out.append("# Minimization Report \n# Variables: ");
+    out.appendNumber(pla.numVars);
+    out.append(result.shared ? "\n# Shared product terms: " : "\n# Product terms: ");
+    out.appendNumber(result.productTerms);
+    if (result.sharingDropped) out.append("\n# Memory budget reached: outputs minimized one by one");
+    out.append("\n\n");
+
+    for (int i = 0; i < pla.numOutputs; i++) {
+        const OutputCover& cover = result.outputs[i];
+        out.append("# Output function ");
+        out.append(i < static_cast<int>(pla.outputLabels.size()) ? pla.outputLabels[i] : to_string(i));
+        out.append("\n# Engine: ");
+        const char* engine = engineName(cover.engine);
+        out.append(engine, strlen(engine));
+        out.push_back('\n');
+        if (cover.inputKept) out.append("# Memory budget reached: input cubes kept unminimized\n");
+        else if (cover.memoryFellBack) out.append("# Memory budget reached: cheaper engine used\n");
+        if (cover.cancelled) out.append("# Deadline reached: best cover found so far\n");
+        if (cover.bddFellBack) out.append("# BDD node limit reached: Espresso used instead\n");
+        // A deadline that cut QM short is already noted above
+        if (cover.engine == Engine::Quine && !cover.provenMinimal && !cover.cancelled) {
+            out.append("# Cover search budget reached: not proven minimal\n");
+        }
+        appendSOP(out, cover.cover, names);
+        out.append("\n\n");
+    }
+    return out.close();
+}
+
+// Distinct product terms over all outputs, each with the outputs it feeds, in
+// order of first use
+static vector<PLACube> resultRows(const MinimizeResult& result, int numVars) {
+    size_t uses = 0;
+    for (const OutputCover& out : result.outputs) uses += out.cover.size();
+    vector<PLACube> rows;
+    rows.reserve(uses);
+    unordered_map<Cube, size_t, CubeHash> rowOf;
+    rowOf.reserve(uses);
+    for (size_t k = 0; k < result.outputs.size(); k++) {
+        for (const Term& t : result.outputs[k].cover) {
+            auto [it, added] = rowOf.emplace(t.getCube(), rows.size());
+            if (added) rows.push_back(PLACube(Term(t.getCube(), numVars), OutputMask()));
+            rows[it->second].outputs.set(static_cast<int>(k));
+        }
+    }
+    return rows;
+}
+
+static void appendLabels(FileWriter& out, const char* keyword, const vector<string>& labels) {
+    out.append(keyword, strlen(keyword));
+    for (const string& label : labels) {
+        out.push_back(' ');
+        out.append(label);
+    }
+    out.push_back('\n');
+}
+
+bool writeResultPLA(const string& path, const PLAFile& pla, const MinimizeResult& result) {
+    if (pla.numOutputs > Cube::MAX_VARS) return false;
+    FileWriter out(path);
+    if (!out.ok()) return false;
+
+    vector<PLACube> rows = resultRows(result, pla.numVars);
+    out.append(".i ");
+    out.appendNumber(pla.numVars);
+    out.append("\n.o ");
+    out.appendNumber(pla.numOutputs);
+    out.push_back('\n');
+    if (static_cast<int>(pla.inputLabels.size()) == pla.numVars) appendLabels(out, ".ilb", pla.inputLabels);
+    if (static_cast<int>(pla.outputLabels.size()) == pla.numOutputs) appendLabels(out, ".ob", pla.outputLabels);
+    // Only the ON-set is written, so readers must not take missing rows as don't-cares
+    out.append(".type f\n.p ");
+    out.appendNumber(rows.size());
+    out.push_back('\n');
+
+    // Each row is formatted in place and appended in one piece
+    string line(pla.numVars + pla.numOutputs + 2, ' ');
+    line.back() = '\n';
+    for (const PLACube& row : rows) {
+        const Cube& cube = row.term.getCube();
+        // Straight from the words: '-' where care is clear, else '0' + value
+        for (int j = 0; j < pla.numVars; j++) {
+            uint64_t care = (cube.care[j >> 6] >> (j & 63)) & 1;
+            uint64_t value = (cube.value[j >> 6] >> (j & 63)) & 1;
+            line[j] = static_cast<char>(care ? '0' + value : '-');
+        }
+        for (int k = 0; k < pla.numOutputs; k++) {
+            line[pla.numVars + 1 + k] = static_cast<char>('0' + ((row.outputs.bits[k >> 6] >> (k & 63)) & 1));
+        }
+        out.append(line);
+    }
+    out.append(".e\n");
+    return out.close();
+}
+
+bool writeCubeList(const string& path, const PLAFile& pla, const MinimizeResult& result) {
+    if (pla.numOutputs > Cube::MAX_VARS) return false;
+    FileWriter out(path);
+    if (!out.ok()) return false;
+
+    bool labelled = static_cast<int>(pla.inputLabels.size()) == pla.numVars &&
+                    static_cast<int>(pla.outputLabels.size()) == pla.numOutputs;
+    out.append(MAGIC, sizeof(MAGIC));
+    out.appendLittleEndian(pla.numVars, 4);
+    out.appendLittleEndian(pla.numOutputs, 4);
+    out.appendLittleEndian(labelled ? pla.numVars + pla.numOutputs : 0, 4);
+    if (labelled) {
+        for (const vector<string>* labels : {&pla.inputLabels, &pla.outputLabels}) {
+            for (const string& label : *labels) {
+                out.appendLittleEndian(label.size(), 4);
+                out.append(label);
+            }
+        }
+    }
+
+    vector<PLACube> rows = resultRows(result, pla.numVars);
+    int inputWords = (pla.numVars + 63) / 64;
+    int outputWords = (pla.numOutputs + 63) / 64;
+    out.appendLittleEndian(rows.size(), 8);
+    for (const PLACube& row : rows) {
+        const Cube& cube = row.term.getCube();
+        for (int w = 0; w < inputWords; w++) out.appendLittleEndian(cube.value[w], 8);
+        for (int w = 0; w < inputWords; w++) out.appendLittleEndian(cube.care[w], 8);
+        for (int w = 0; w < outputWords; w++) out.appendLittleEndian(row.outputs.bits[w], 8);
+    }
+    return out.close();
+}
+
+bool writeResult(const string& path, const string& format, const PLAFile& pla, const MinimizeResult& result) {
+    if (format == "pla") return writeResultPLA(path, pla, result);
+    if (format == "binary") return writeCubeList(path, pla, result);
+    if (format == "report") return writeReport(path, pla, result);
+    throw invalid_argument("unknown output format " + format);
+}
+
+// Little-endian reads over a byte buffer; a read past the end clears ok
+class ByteReader {
+public:
+    ByteReader(const vector<char>& bytes) : p(bytes.data()), end(bytes.data() + bytes.size()) {}
+
+    uint64_t number(int bytes) {
+        if (end - p < bytes) {
+            ok = false;
+            return 0;
+        }
+        uint64_t n = 0;
+        for (int i = 0; i < bytes; i++) n |= uint64_t(static_cast<unsigned char>(p[i])) << (8 * i);
+        p += bytes;
+        return n;
+    }
+    string text(size_t length) {
+        if (static_cast<size_t>(end - p) < length) {
+            ok = false;
+            return string();
+        }
+        string s(p, length);
+        p += length;
+        return s;
+    }
+    size_t left() const { return static_cast<size_t>(end - p); }
+
+    bool ok = true;
+
+private:
+    const char* p;
+    const char* end;
+};
+
+bool readCubeList(const string& path, PLAFile& pla) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        cerr << "Error opening cube list " << path << "\n";
+        return false;
+    }
+    vector<char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    ByteReader reader(bytes);
+    if (reader.text(sizeof(MAGIC)) != string(MAGIC, sizeof(MAGIC))) {
+        cerr << path << " is not a cube list\n";
+        return false;
+    }
+    PLAFile read;
+    read.type = "f";
+    uint64_t numVars = reader.number(4);
+    uint64_t numOutputs = reader.number(4);
+    uint64_t labels = reader.number(4);
+    if (!reader.ok || numVars > static_cast<uint64_t>(Cube::MAX_VARS) || numOutputs == 0 ||
+        numOutputs > static_cast<uint64_t>(Cube::MAX_VARS) || (labels != 0 && labels != numVars + numOutputs)) {
+        cerr << path << ": bad cube list header\n";
+        return false;
+    }
+    read.numVars = static_cast<int>(numVars);
+    read.numOutputs = static_cast<int>(numOutputs);
+    for (uint64_t i = 0; i < labels && reader.ok; i++) {
+        string label = reader.text(reader.number(4));
+        (i < numVars ? read.inputLabels : read.outputLabels).push_back(label);
+    }
+
+    int inputWords = (read.numVars + 63) / 64;
+    int outputWords = (read.numOutputs + 63) / 64;
+    uint64_t rows = reader.number(8);
+    // Checked against the bytes present before anything is reserved
+    if (!reader.ok || rows > reader.left() / (8 * (2 * inputWords + outputWords))) {
+        cerr << path << ": truncated cube list\n";
+        return false;
+    }
+    read.declaredProducts = rows;
+    read.onRows.reserve(rows);
+    for (uint64_t r = 0; r < rows; r++) {
+        Cube cube;
+        OutputMask outputs;
+        for (int w = 0; w < inputWords; w++) cube.value[w] = reader.number(8);
+        for (int w = 0; w < inputWords; w++) cube.care[w] = reader.number(8);
+        for (int w = 0; w < outputWords; w++) outputs.bits[w] = reader.number(8);
+        // Value bits must stay inside the care bits for cube equality to work
+        for (int w = 0; w < inputWords; w++) {
+            if (cube.value[w] & ~cube.care[w]) {
+                cerr << path << ": row " << r << " has value bits outside its care bits\n";
+                return false;
+            }
+        }
+        read.onRows.push_back(PLACube(Term(cube, read.numVars), outputs));
+    }
+
+    pla = move(read);
+    return true;
+}
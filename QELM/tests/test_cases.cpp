@@ -6,3 +6,810 @@
 //
 
 #include <stdio.h>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cube.hpp"
+#include "term.hpp"
+#include "combine.hpp"
+#include "cubeops.hpp"
+#include "cube_batch.hpp"
+#include "quine.hpp"
+#include "espresso.hpp"
+#include "bdd.hpp"
+#include "pla.hpp"
+#include "minimizer.hpp"
+#include "utils.hpp"
+#include "writer.hpp"
+#include "budget.hpp"
+#include "cache.hpp"
+#include "batch.hpp"
+#include "thread_pool.hpp"
+#include "arena.hpp"
+
+using namespace std;
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        checks++;                                                           \
+        if (!(cond)) {                                                      \
+            failures++;                                                     \
+            printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+        }                                                                   \
+    } while (0)
+
+// Truth table entry of a random function: 0 = off, 1 = on, 2 = don't care
+struct TestFunction {
+    int numVars;
+    vector<int> table;
+    vector<Term> on, dc;
+};
+
+static TestFunction randomFunction(mt19937& rng, int numVars, int onPercent, int dcPercent) {
+    TestFunction f;
+    f.numVars = numVars;
+    f.table.assign(size_t(1) << numVars, 0);
+    for (int m = 0; m < (1 << numVars); m++) {
+        int r = static_cast<int>(rng() % 100);
+        if (r < onPercent) {
+            f.table[m] = 1;
+            f.on.push_back(Term(m, numVars));
+        } else if (r < onPercent + dcPercent) {
+            f.table[m] = 2;
+            f.dc.push_back(Term(m, numVars, true));
+        }
+    }
+    return f;
+}
+
+// The cover must contain every on minterm and no off minterm
+static bool implements(const vector<Term>& cover, const TestFunction& f) {
+    for (int m = 0; m < (1 << f.numVars); m++) {
+        bool covered = false;
+        for (const Term& t : cover) {
+            if (t.coversMinterm(m)) {
+                covered = true;
+                break;
+            }
+        }
+        if (f.table[m] == 1 && !covered) return false;
+        if (f.table[m] == 0 && covered) return false;
+    }
+    return true;
+}
+
+static void testCube() {
+    Cube c = Cube::fromString("1-0");
+    CHECK(c.toString(3) == "1-0");
+    CHECK(c.countLiterals() == 2);
+    CHECK(c.contains(Cube::fromString("110")));
+    CHECK(!c.contains(Cube::fromString("111")));
+    CHECK(c.intersects(Cube::fromString("--0")));
+    CHECK(!c.intersects(Cube::fromString("0--")));
+    CHECK(Cube::fromString("100").isAdjacent(Cube::fromString("110")));
+    CHECK(Cube::fromString("100").merge(Cube::fromString("110")) == c);
+    CHECK(c.containsMinterm(4, 3) && c.containsMinterm(6, 3) && !c.containsMinterm(5, 3));
+
+    vector<int> minterms;
+    for (int m : MintermRange(c, 3)) minterms.push_back(m);
+    CHECK((minterms == vector<int>{4, 6}));
+}
+
+static void testCombine() {
+    // f = sum(0, 1, 2, 3) over 3 variables -> A'
+    vector<Term> terms;
+    for (int m = 0; m < 4; m++) terms.push_back(Term(m, 3));
+    vector<Term> round1 = combineTerms(terms);
+    CHECK(round1.size() == 4);
+    // 0-- comes out of two pairs but is returned once
+    vector<Term> round2 = combineTerms(round1);
+    CHECK(round2.size() == 1 && round2[0].getBinary() == "0--");
+    vector<Term> round3 = combineTerms(round2);
+    CHECK(round3 == round2);
+    CHECK(combineTerms({}).empty());
+
+    // Thread count must not change the result
+    mt19937 rng(11);
+    TestFunction f = randomFunction(rng, 14, 50, 0);
+    CHECK(combineTerms(f.on, 1) == combineTerms(f.on, 4));
+}
+
+static void testCubeBatch() {
+    mt19937 rng(19);
+    CubeKernel original = cubeKernel();
+    for (CubeKernel kernel : {CubeKernel::Scalar, CubeKernel::Avx2, CubeKernel::Avx512}) {
+        if (!setCubeKernel(kernel)) continue;
+        for (int it = 0; it < 200; it++) {
+            // Wide cubes now and then, so every word of the array is used
+            int numVars = 1 + static_cast<int>(rng() % (it % 4 == 0 ? Cube::MAX_VARS : 12));
+            auto randomCube = [&]() {
+                Cube c;
+                for (int j = 0; j < numVars; j++) {
+                    int r = static_cast<int>(rng() % 3);
+                    if (r < 2) c.setLiteral(j, r ? '1' : '0');
+                }
+                return c;
+            };
+            Cube c = randomCube();
+            vector<Cube> F;
+            int size = static_cast<int>(rng() % 150);
+            for (int i = 0; i < size; i++) F.push_back(randomCube());
+            // Some neighbours of c, for the adjacency and distance masks
+            for (int i = 0; i < size; i += 5) {
+                F[i] = c;
+                int j = static_cast<int>(rng() % numVars);
+                if (c.literal(j) != '-') F[i].setLiteral(j, c.literal(j) == '1' ? '0' : '1');
+            }
+
+            CubeArray array(F, numVars);
+            MatchMask meets, inside, outside, adjacent, one, two;
+            matchIntersects(c, array, meets);
+            matchContainedIn(c, array, inside);
+            matchContaining(c, array, outside);
+            matchAdjacent(c, array, adjacent);
+            matchDistance(c, array, one, two);
+            bool any = false;
+            for (int i = 0; i < size; i++) {
+                auto bit = [i](const MatchMask& m) { return ((m[i / 64] >> (i % 64)) & 1) != 0; };
+                int distance = 0;
+                for (int w = 0; w < Cube::WORDS; w++) {
+                    distance += __builtin_popcountll((c.value[w] ^ F[i].value[w]) & c.care[w] & F[i].care[w]);
+                }
+                CHECK(bit(meets) == c.intersects(F[i]));
+                CHECK(bit(inside) == c.contains(F[i]));
+                CHECK(bit(outside) == F[i].contains(c));
+                CHECK(bit(adjacent) == c.isAdjacent(F[i]));
+                CHECK(bit(one) == (distance == 1) && bit(two) == (distance == 2));
+                any |= c.intersects(F[i]);
+            }
+            CHECK(anyIntersects(c, array) == any);
+        }
+    }
+    setCubeKernel(original);
+}
+
+static void testCubeCalculus() {
+    mt19937 rng(3);
+    for (int it = 0; it < 300; it++) {
+        int numVars = 2 + static_cast<int>(rng() % 6);
+        vector<Cube> F;
+        int size = static_cast<int>(rng() % 12);
+        for (int i = 0; i < size; i++) {
+            Cube c;
+            for (int j = 0; j < numVars; j++) {
+                int r = static_cast<int>(rng() % 3);
+                if (r < 2) c.setLiteral(j, r ? '1' : '0');
+            }
+            F.push_back(c);
+        }
+
+        vector<Cube> C = complement(F, numVars);
+        bool tautology = true;
+        for (int m = 0; m < (1 << numVars); m++) {
+            Cube minterm = Cube::fromMinterm(m, numVars);
+            bool inF = false, inC = false;
+            for (const Cube& f : F) inF |= f.contains(minterm);
+            for (const Cube& c : C) inC |= c.contains(minterm);
+            CHECK(inF != inC);
+            tautology &= inF;
+        }
+        CHECK(isTautology(F, numVars) == tautology);
+
+        Cube sc;
+        CHECK(supercubeOfComplement(F, numVars, sc) == !C.empty());
+        if (!C.empty()) CHECK(sc == supercube(C));
+
+        // Consensus on the cubes finds the same primes as combining their minterms
+        vector<Term> current;
+        for (int m = 0; m < (1 << numVars); m++) {
+            for (const Cube& f : F) {
+                if (f.contains(Cube::fromMinterm(m, numVars))) {
+                    current.push_back(Term(m, numVars));
+                    break;
+                }
+            }
+        }
+        vector<Term> next;
+        while ((next = combineTerms(current)) != current) current.swap(next);
+        vector<Cube> primes;
+        for (const Term& t : current) primes.push_back(t.getCube());
+        sort(primes.begin(), primes.end());
+        CHECK(allPrimes(F, numVars) == primes);
+    }
+}
+
+static void testQuine() {
+    // Sample from data/input.txt
+    vector<Term> on = {Term(2, 3), Term(3, 3), Term(6, 3), Term(7, 3)};
+    CHECK(termsToSOP(runQuine(on, {}), 3) == "B");
+
+    mt19937 rng(5);
+    for (int it = 0; it < 60; it++) {
+        TestFunction f = randomFunction(rng, 2 + static_cast<int>(rng() % 7), 40, 20);
+        bool optimal = false;
+        QuineStats stats;
+        vector<Term> cover = runQuine(f.on, f.dc, 1, CoverOptions(), &optimal, &stats);
+        CHECK(implements(cover, f));
+        CHECK(stats.rounds >= 1);
+        CHECK(f.on.empty() || stats.primes >= cover.size());
+
+        // A proven-minimal cover never has more cubes than a heuristic one
+        vector<Term> heuristic = runEspressoMultiple(f.on, f.dc, f.numVars, 3);
+        if (optimal) CHECK(cover.size() <= heuristic.size());
+
+        // The same function as cubes: large ones go through consensus, and
+        // either way the primes and the minimum cover are unchanged
+        vector<Term> onCubes = runEspressoMultiple(f.on, {}, f.numVars, 1);
+        vector<Term> dcCubes = runEspressoMultiple(f.dc, {}, f.numVars, 1);
+        bool cubeOptimal = false;
+        QuineStats cubeStats;
+        vector<Term> cubeCover = runQuine(onCubes, dcCubes, 1, CoverOptions(), &cubeOptimal, &cubeStats);
+        CHECK(implements(cubeCover, f));
+        CHECK(cubeStats.primes == stats.primes);
+        if (optimal && cubeOptimal) CHECK(cubeCover.size() == cover.size());
+    }
+
+    // Cubes with different free variables never combine; their primes still appear
+    CHECK(termsToSOP(runQuine({Term("1-"), Term("01")}, {}), 2) == "B + A");
+}
+
+static void testEspresso() {
+    mt19937 rng(7);
+    for (int it = 0; it < 60; it++) {
+        TestFunction f = randomFunction(rng, 2 + static_cast<int>(rng() % 8), 40, 20);
+        CHECK(implements(runEspressoOnce(f.on, f.dc, f.numVars, 1), f));
+
+        EspressoOptions serial;
+        serial.passes = 4;
+        EspressoOptions parallel = serial;
+        parallel.numThreads = 4;
+        vector<Term> a = runEspressoMultiple(f.on, f.dc, f.numVars, serial);
+        CHECK(implements(a, f));
+        CHECK(a == runEspressoMultiple(f.on, f.dc, f.numVars, parallel));
+    }
+}
+
+static void testBdd() {
+    mt19937 rng(9);
+    for (int it = 0; it < 60; it++) {
+        TestFunction f = randomFunction(rng, 2 + static_cast<int>(rng() % 8), 40, 20);
+        CHECK(implements(runBddMinimize(f.on, f.dc, f.numVars), f));
+    }
+
+    BddOptions tiny;
+    tiny.nodeLimit = 8;
+    TestFunction f = randomFunction(rng, 8, 50, 0);
+    bool threw = false;
+    try {
+        runBddMinimize(f.on, {}, 8, tiny);
+    } catch (const length_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+static void testMultiOutput() {
+    mt19937 rng(13);
+    for (int it = 0; it < 30; it++) {
+        int numVars = 3 + static_cast<int>(rng() % 5);
+        int numOutputs = 1 + static_cast<int>(rng() % 4);
+        vector<TestFunction> f;
+        for (int k = 0; k < numOutputs; k++) f.push_back(randomFunction(rng, numVars, 40, 15));
+
+        vector<PLACube> on, dc;
+        for (int k = 0; k < numOutputs; k++) {
+            OutputMask mask;
+            mask.set(k);
+            for (const Term& t : f[k].on) on.push_back(PLACube(t, mask));
+            for (const Term& t : f[k].dc) dc.push_back(PLACube(t, mask));
+        }
+
+        EspressoOptions options;
+        options.passes = 2;
+        vector<vector<PLACube>> perOutput = groupByOutput(runEspressoMultiOutput(on, dc, numVars, numOutputs, options), numOutputs);
+        for (int k = 0; k < numOutputs; k++) {
+            vector<Term> cover;
+            for (const PLACube& c : perOutput[k]) cover.push_back(c.term);
+            CHECK(implements(cover, f[k]));
+        }
+    }
+}
+
+static string writeTemp(const string& name, const string& text) {
+    string path = "build/" + name;
+    ofstream out(path);
+    out << text;
+    return path;
+}
+
+static void testPLA() {
+    PLAFile pla;
+    string path = writeTemp("test_fd.pla",
+        "# comment\n.i 3\n.o 2\n.ilb a b c\n.ob f g\n.p 3\n1-0 10\n011 -1\n111 11\n.e\n");
+    CHECK(parsePLA(path, pla));
+    CHECK(pla.numVars == 3 && pla.numOutputs == 2 && pla.declaredProducts == 3);
+    CHECK((pla.inputLabels == vector<string>{"a", "b", "c"}));
+    CHECK((pla.outputLabels == vector<string>{"f", "g"}));
+    CHECK(pla.onRows.size() == 3 && pla.dcRows.size() == 1);
+    CHECK(pla.onRows[0].term.getBinary() == "1-0");
+
+    // A .p far past what the file holds is only a declared count
+    PLAFile huge;
+    CHECK(parsePLA(writeTemp("test_huge_p.pla", ".i 3\n.o 1\n.p 1073741824\n011 1\n.e\n"), huge));
+    CHECK(huge.declaredProducts == 1073741824 && huge.onRows.size() == 1);
+
+    vector<vector<Term>> on = splitByOutput(pla.onRows, 2);
+    CHECK(on[0].size() == 2 && on[1].size() == 2);
+
+    // fr: what is neither on nor off is don't care
+    path = writeTemp("test_fr.pla", ".i 2\n.o 1\n.type fr\n11 1\n00 0\n.e\n");
+    CHECK(parsePLA(path, pla));
+    CHECK(pla.onRows.size() == 1 && pla.offRows.size() == 1);
+    size_t dcMinterms = 0;
+    for (const PLACube& c : pla.dcRows) dcMinterms += c.term.getCoveredMinterms().size();
+    CHECK(dcMinterms == 2);
+
+    path = writeTemp("test_bad.pla", ".i 2\n.o 1\n0x 1\n");
+    CHECK(!parsePLA(path, pla));
+    CHECK(!parsePLA("build/does_not_exist.pla", pla));
+}
+
+static void testWriter() {
+    // Labels: letters up to 26 inputs, x0.. past that, .ilb names when given
+    vector<Term> cover = {Term("1-0"), Term("011")};
+    CHECK(termsToSOP(cover, 3) == "AC' + A'BC");
+    CHECK(termsToSOP(cover, 3, {"a", "b", "c"}) == "ac' + a'bc");
+    CHECK(termsToSOP(cover, 3, {"in0", "in1", "in2"}) == "in0 in2' + in0' in1 in2");
+    Cube wide;
+    wide.setLiteral(0, '1');
+    wide.setLiteral(29, '0');
+    CHECK(termsToSOP({Term(wide, 30)}, 30) == "x0 x29'");
+
+    PLAFile pla;
+    string path = writeTemp("test_writer.pla", ".i 3\n.o 2\n.ilb a b c\n.ob f g\n011 11\n010 11\n110 01\n.e\n");
+    CHECK(parsePLA(path, pla));
+    MinimizerOptions options;
+    options.engine = Engine::Quine;
+    MinimizeResult result = Minimizer(options).minimize(pla);
+
+    // The PLA writer shares a row between outputs using the same product term
+    string plaPath = "build/test_writer_out.pla";
+    CHECK(writeResultPLA(plaPath, pla, result));
+    PLAFile written;
+    CHECK(parsePLA(plaPath, written));
+    CHECK(written.inputLabels == pla.inputLabels && written.outputLabels == pla.outputLabels);
+    CHECK(written.onRows.size() == 2 && written.declaredProducts == 2);
+    // Rows cover only the ON-set, so the type follows the labels
+    CHECK(written.type == "f");
+    ifstream plaIn(plaPath);
+    string plaText((istreambuf_iterator<char>(plaIn)), istreambuf_iterator<char>());
+    CHECK(plaText.find(".ob f g\n.type f\n.p 2\n") != string::npos);
+
+    // The cube list reads back to the same rows
+    string binPath = "build/test_writer_out.qcb";
+    CHECK(writeCubeList(binPath, pla, result));
+    PLAFile binary;
+    CHECK(readCubeList(binPath, binary));
+    CHECK(binary.numVars == 3 && binary.numOutputs == 2);
+    CHECK(binary.inputLabels == pla.inputLabels && binary.outputLabels == pla.outputLabels);
+    CHECK(binary.onRows.size() == written.onRows.size());
+    for (size_t i = 0; i < binary.onRows.size() && i < written.onRows.size(); i++) {
+        CHECK(binary.onRows[i].term == written.onRows[i].term);
+        CHECK(binary.onRows[i].outputs == written.onRows[i].outputs);
+    }
+    CHECK(!readCubeList(plaPath, binary));
+
+    string reportPath = "build/test_writer_report.txt";
+    CHECK(writeReport(reportPath, pla, result));
+    ifstream in(reportPath);
+    string report((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    CHECK(report.find("# Output function g\n# Engine: quine\n") != string::npos);
+    CHECK(report.find("\na'b\n") != string::npos);
+}
+
+static void testIncremental() {
+    mt19937 rng(15);
+    for (int it = 0; it < 40; it++) {
+        int numVars = 3 + static_cast<int>(rng() % 6);
+        TestFunction f = randomFunction(rng, numVars, 40, 15);
+        vector<Term> cover = runEspressoOnce(f.on, f.dc, numVars);
+
+        // Flip a few minterms between on, off and dc
+        CoverDelta delta;
+        for (int e = 0; e < 3; e++) {
+            int m = static_cast<int>(rng() % (1u << numVars));
+            int next = static_cast<int>(rng() % 3);
+            if (next == f.table[m]) continue;
+            if (f.table[m] == 1) delta.removedOn.push_back(Term(m, numVars));
+            if (f.table[m] == 2) delta.removedDc.push_back(Term(m, numVars, true));
+            if (next == 1) delta.addedOn.push_back(Term(m, numVars));
+            if (next == 2) delta.addedDc.push_back(Term(m, numVars, true));
+            f.table[m] = next;
+        }
+        f.on.clear();
+        f.dc.clear();
+        for (int m = 0; m < (1 << numVars); m++) {
+            if (f.table[m] == 1) f.on.push_back(Term(m, numVars));
+            if (f.table[m] == 2) f.dc.push_back(Term(m, numVars, true));
+        }
+
+        vector<Term> updated = updateCover(cover, f.on, f.dc, delta, numVars);
+        CHECK(implements(updated, f));
+        CHECK(irredundant(updated, f.dc, numVars).size() == updated.size());
+    }
+
+    // Through the PLA diff and the Minimizer
+    PLAFile before, after;
+    CHECK(parsePLA(writeTemp("test_before.pla", ".i 3\n.o 2\n01- 10\n11- 11\n001 01\n.e\n"), before));
+    CHECK(parsePLA(writeTemp("test_after.pla", ".i 3\n.o 2\n01- 10\n111 11\n001 01\n000 01\n.e\n"), after));
+    PLADelta delta = diffPLA(before, after);
+    CHECK(delta.addedOn.size() == 3 && delta.removedOn.size() == 2);
+
+    Minimizer minimizer;
+    MinimizeResult updated = minimizer.update(minimizer.minimize(before), after, delta);
+    CHECK(termsToSOP(updated.outputs[0].cover, 3) == "BC + A'B");
+    CHECK(termsToSOP(updated.outputs[1].cover, 3) == "A'B' + ABC");
+
+    // A reworked output no longer carries the flags of the old result
+    MinimizeResult previous = minimizer.minimize(before);
+    for (OutputCover& out : previous.outputs) {
+        out.engine = Engine::Quine;
+        out.fromCache = out.cancelled = out.memoryFellBack = true;
+    }
+    updated = minimizer.update(previous, after, delta);
+    for (const OutputCover& out : updated.outputs) {
+        CHECK(out.engine == Engine::Espresso && !out.fromCache && !out.cancelled && !out.memoryFellBack);
+    }
+
+    // A different input count means a full minimize
+    PLAFile wider;
+    CHECK(parsePLA(writeTemp("test_wider.pla", ".i 4\n.o 2\n01-0 10\n111- 11\n0011 01\n.e\n"), wider));
+    updated = minimizer.update(minimizer.minimize(before), wider, diffPLA(before, wider));
+    MinimizeResult full = minimizer.minimize(wider);
+    for (int i = 0; i < 2; i++) CHECK(updated.outputs[i].cover == full.outputs[i].cover);
+}
+
+static void testMinimizer() {
+    vector<Term> small = {Term(1, 4), Term(3, 4)};
+    CHECK(Minimizer::chooseEngine(small, {}, 4) == Engine::Quine);
+
+    vector<Term> wide = {Term(string(40, '-').replace(0, 1, "1"))};
+    CHECK(Minimizer::chooseEngine(wide, {}, 40) == Engine::Espresso);
+
+    Engine e;
+    CHECK(parseEngine("bdd", e) && e == Engine::Bdd);
+    CHECK(!parseEngine("fast", e));
+
+    PLAFile pla;
+    CHECK(parsePLA(writeTemp("test_min.pla", ".i 3\n.o 2\n01- 10\n11- 11\n001 01\n100 01\n.e\n"), pla));
+    for (Engine engine : {Engine::Auto, Engine::Quine, Engine::Espresso, Engine::Bdd}) {
+        MinimizerOptions options;
+        options.engine = engine;
+        options.numThreads = 2;
+        MinimizeResult result = Minimizer(options).minimize(pla);
+        CHECK(result.outputs.size() == 2);
+        CHECK(termsToSOP(result.outputs[0].cover, 3) == "B");
+    }
+}
+
+static void testMemoryBudget() {
+    mt19937 rng(23);
+    TestFunction f = randomFunction(rng, 12, 45, 10);
+
+    bool threw = false;
+    try {
+        runQuine(f.on, f.dc, 1, CoverOptions(), nullptr, nullptr, 64 << 10);
+    } catch (const MemoryBudgetExceeded&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    // QM over its budget gives way to a cheaper engine
+    MinimizerOptions options;
+    options.engine = Engine::Quine;
+    options.memoryBudgetBytes = 256 << 10;
+    OutputCover out = Minimizer(options).minimizeFunction(f.on, f.dc, f.numVars);
+    CHECK(out.memoryFellBack && !out.inputKept && !out.provenMinimal);
+    CHECK(out.engine != Engine::Quine);
+    CHECK(implements(out.cover, f));
+
+    // Nothing fits: the input cubes are kept
+    options.memoryBudgetBytes = 1;
+    out = Minimizer(options).minimizeFunction(f.on, f.dc, f.numVars);
+    CHECK(out.memoryFellBack && out.inputKept);
+    CHECK(out.cover.size() == f.on.size());
+    CHECK(implements(out.cover, f));
+
+    options.memoryBudgetBytes = 0;
+    out = Minimizer(options).minimizeFunction(f.on, f.dc, f.numVars);
+    CHECK(!out.memoryFellBack && out.engine == Engine::Quine);
+
+    // BDD over its budget gives way to Espresso, not to the input: x0 + ... + x39
+    // needs over 40 nodes but has a one-cube OFF-set
+    vector<Term> literals;
+    for (int j = 0; j < 40; j++) {
+        Cube c;
+        c.setLiteral(j, '1');
+        literals.push_back(Term(c, 40));
+    }
+    options.engine = Engine::Bdd;
+    options.memoryBudgetBytes = 1024;
+    out = Minimizer(options).minimizeFunction(literals, {}, 40);
+    CHECK(out.memoryFellBack && !out.inputKept && out.engine == Engine::Espresso);
+    CHECK(out.cover.size() == 40);
+
+    // The shared Espresso run drops to one output at a time
+    PLAFile pla;
+    CHECK(parsePLA(writeTemp("test_budget.pla", ".i 4\n.o 2\n0101 10\n1-1- 11\n0011 01\n1000 01\n.e\n"), pla));
+    options.engine = Engine::Espresso;
+    options.memoryBudgetBytes = 1;
+    MinimizeResult result = Minimizer(options).minimize(pla);
+    CHECK(result.sharingDropped && !result.shared);
+    CHECK(result.outputs[0].inputKept && result.outputs[1].inputKept);
+
+    string reportPath = "build/test_budget_report.txt";
+    CHECK(writeReport(reportPath, pla, result));
+    ifstream in(reportPath);
+    string report((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    CHECK(report.find("# Memory budget reached: input cubes kept unminimized\n") != string::npos);
+}
+
+static void testCancel() {
+    CancelToken never;
+    CHECK(!never.expired() && !cancelRequested(&never) && !cancelRequested(nullptr));
+    CancelToken fired;
+    fired.cancel();
+    CHECK(fired.expired());
+    CancelToken past(1e-9);
+    CHECK(past.expired());
+
+    mt19937 rng(24);
+    TestFunction f = randomFunction(rng, 10, 40, 8);
+
+    // Each engine still hands back a cover of the function
+    CoverOptions coverOptions;
+    coverOptions.cancel = &fired;
+    bool optimal = true;
+    QuineStats stats;
+    vector<Term> cover = runQuine(f.on, f.dc, 1, coverOptions, &optimal, &stats);
+    CHECK(stats.cancelled && !optimal);
+    CHECK(implements(cover, f));
+
+    EspressoOptions espressoOptions;
+    espressoOptions.cancel = &fired;
+    CHECK(implements(runEspressoMultiple(f.on, f.dc, f.numVars, espressoOptions), f));
+
+    vector<vector<int>> rows = {{0, 1}, {1, 2}, {0, 2}};
+    CoverResult solved = solveCover(rows, {1, 1, 1}, coverOptions);
+    CHECK(!solved.optimal);
+
+    MinimizerOptions options;
+    options.engine = Engine::Quine;
+    options.cancel = &fired;
+    OutputCover out = Minimizer(options).minimizeFunction(f.on, f.dc, f.numVars);
+    CHECK(out.cancelled && !out.provenMinimal);
+    CHECK(implements(out.cover, f));
+
+    // The report notes the deadline once, not also as a cover search budget
+    PLAFile pla;
+    CHECK(parsePLA(writeTemp("test_cancel.pla", ".i 3\n.o 1\n011 1\n010 1\n110 1\n.e\n"), pla));
+    MinimizeResult result = Minimizer(options).minimize(pla);
+    string reportPath = "build/test_cancel_report.txt";
+    CHECK(writeReport(reportPath, pla, result));
+    ifstream in(reportPath);
+    string report((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    CHECK(report.find("# Deadline reached: best cover found so far\n") != string::npos);
+    CHECK(report.find("budget reached") == string::npos);
+
+    options.cancel = &never;
+    out = Minimizer(options).minimizeFunction(f.on, f.dc, f.numVars);
+    CHECK(!out.cancelled && out.provenMinimal);
+}
+
+static void testBatch() {
+    string directory = "build/test_batch";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory + "/in/sub");
+    string multi = writeTemp("test_batch/in/multi.pla", ".i 4\n.o 2\n01-- 10\n11-1 11\n0011 01\n1000 -1\n.e\n");
+    writeTemp("test_batch/in/single.pla", ".i 3\n.o 1\n011 1\n010 1\n110 1\n.e\n");
+    writeTemp("test_batch/in/bad.pla", ".i 3\n.o 1\n01x 1\n.e\n");
+    writeTemp("test_batch/in/notes.txt", "not a PLA\n");
+    // Same stem as in/multi.pla
+    writeTemp("test_batch/in/sub/multi.pla", ".i 2\n.o 1\n1- 1\n.e\n");
+
+    vector<string> files;
+    CHECK(collectBatchInputs({directory + "/in", "@" + writeTemp("test_batch/list.txt", multi + "\n")}, files));
+    CHECK(files.size() == 4 && files[0] == directory + "/in/bad.pla" && files[3] == multi);
+    files.push_back(directory + "/in/sub/multi.pla");
+    CHECK(!collectBatchInputs({"@build/test_batch/missing.txt"}, files));
+
+    // With a chunk cache the next arena on the thread reuses the chunks of the last
+    vector<ArenaStats> arenas;
+    setArenaStatsHook([&](const ArenaStats& stats) { arenas.push_back(stats); });
+    setArenaChunkCache(1 << 20);
+    for (int run = 0; run < 2; run++) {
+        ArenaScope scope("test");
+        pmr::vector<Cube> cubes(1000, Cube(), scratchResource());
+    }
+    setArenaChunkCache(0);
+    setArenaStatsHook(nullptr);
+    CHECK(arenas.size() == 2 && arenas[0].reusedChunks == 0 && arenas[0].chunks > 0);
+    CHECK(arenas[1].reusedChunks == arenas[0].chunks && arenas[1].chunks == 0);
+
+    // minimizeAsync gives what minimize gives
+    PLAFile pla;
+    CHECK(parsePLA(multi, pla));
+    MinimizerOptions options;
+    options.numThreads = 2;
+    MinimizeResult expected = Minimizer(options).minimize(pla);
+    {
+        ThreadPool pool(2);
+        promise<MinimizeResult> done;
+        Minimizer(options).minimizeAsync(make_shared<PLAFile>(pla), pool, [&](MinimizeResult result, exception_ptr error) {
+            CHECK(!error);
+            done.set_value(move(result));
+        });
+        MinimizeResult result = done.get_future().get();
+        CHECK(result.productTerms == expected.productTerms);
+        for (int i = 0; i < pla.numOutputs; i++) CHECK(result.outputs[i].cover == expected.outputs[i].cover);
+    }
+
+    BatchOptions batch;
+    batch.minimizer = options;
+    batch.outputDirectory = directory + "/out";
+    batch.format = "binary";
+    BatchSummary summary = runBatch(files, batch);
+    CHECK(summary.files.size() == 5 && summary.failed == 1 && summary.threads == 2);
+    CHECK(summary.files[0].error == "cannot parse input" && summary.files[0].output.empty());
+    CHECK(summary.files[1].output == directory + "/out/multi.qcb");
+    CHECK(summary.files[3].output == directory + "/out/multi-2.qcb");
+    CHECK(summary.files[4].output == directory + "/out/multi-3.qcb");
+    CHECK(summary.files[1].productTerms == expected.productTerms && summary.files[1].numOutputs == 2);
+
+    PLAFile written;
+    CHECK(readCubeList(summary.files[1].output, written));
+    CHECK(written.numOutputs == 2 && written.onRows.size() == expected.productTerms);
+
+    // A file whose task throws is counted as failed and the batch still ends
+    batch.format = "xml";
+    batch.outputDirectory = directory + "/out";
+    summary = runBatch({multi, directory + "/in/single.pla"}, batch);
+    CHECK(summary.failed == 2 && summary.files[0].error == "unknown output format xml");
+    batch.format = "report";
+    batch.minimizer.engine = Engine::Quine;
+    string wide = writeTemp("test_batch/wide.pla", ".i 40\n.o 1\n" + string(40, '1') + " 1\n.e\n");
+    summary = runBatch({wide, directory + "/in/single.pla"}, batch);
+    CHECK(summary.failed == 1 && summary.files[0].error == "the quine engine handles at most 31 variables");
+    CHECK(summary.files[1].error.empty());
+
+    // An output that would overwrite its input is refused
+    batch.format = "pla";
+    batch.outputDirectory = directory + "/in/sub";
+    summary = runBatch({directory + "/in/sub/multi.pla"}, batch);
+    CHECK(summary.failed == 1 && summary.files[0].error == "output would replace the input");
+
+    string summaryPath = directory + "/summary.tsv";
+    CHECK(writeBatchSummary(summaryPath, summary));
+    ifstream in(summaryPath);
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    CHECK(text.find("# Failed: 1\n") != string::npos);
+    CHECK(text.find("\tstatus\n" + directory + "/in/sub/multi.pla\t") != string::npos);
+}
+
+static void testCache() {
+    string directory = "build/test_cache";
+    std::filesystem::remove_all(directory);
+
+    PLAFile pla, shuffled;
+    CHECK(parsePLA(writeTemp("test_cache.pla", ".i 4\n.o 2\n.ob f g\n01-- 10\n11-1 11\n0011 01\n1000 -1\n.e\n"), pla));
+    // Same functions with the outputs swapped, rows reordered and other labels
+    CHECK(parsePLA(writeTemp("test_cache2.pla", ".i 4\n.o 2\n.ob x y\n1000 1-\n0011 10\n11-1 11\n01-- 01\n.e\n"), shuffled));
+
+    MinimizerOptions options;
+    options.cacheDirectory = directory;
+    options.engine = Engine::Quine;
+    MinimizeResult first = Minimizer(options).minimize(pla);
+    CHECK(!first.outputs[0].fromCache && !first.outputs[1].fromCache);
+
+    MinimizeResult second = Minimizer(options).minimize(shuffled);
+    CHECK(second.outputs[0].fromCache && second.outputs[1].fromCache);
+    CHECK(second.outputs[0].cover == first.outputs[1].cover && second.outputs[1].cover == first.outputs[0].cover);
+    CHECK(second.outputs[0].provenMinimal == first.outputs[1].provenMinimal);
+
+    // Options that change the cover are part of the key
+    options.engine = Engine::Espresso;
+    MinimizeResult espresso = Minimizer(options).minimize(pla);
+    CHECK(!espresso.outputs[0].fromCache && espresso.shared);
+    CHECK(Minimizer(options).minimize(pla).outputs[1].fromCache);
+
+    // A damaged entry is a miss and is dropped: a huge cube count, value bits
+    // outside the care bits, a truncated file
+    ResultCache cache(directory, uint64_t(1) << 20);
+    CacheKeyBuilder builder;
+    builder.addTag("damaged");
+    CacheKey key = builder.key();
+    string entry = directory + "/" + key.hex() + ".qc";
+    vector<CachedCover> stored(1), read;
+    stored[0].cover = {Term("1-0"), Term("011")};
+    for (int damage = 0; damage < 3; damage++) {
+        cache.store(key, 3, stored);
+        CHECK(cache.lookup(key, 3, read) && read[0].cover == stored[0].cover);
+        std::fstream file(entry, ios::in | ios::out | ios::binary);
+        if (damage == 0) {
+            file.seekp(18);
+            uint32_t cubes = 0xFFFFFFF0;
+            file.write(reinterpret_cast<const char*>(&cubes), sizeof(cubes));
+        } else if (damage == 1) {
+            file.seekp(22);
+            uint64_t value = 0x3;   // variable 1 is a don't-care in 1-0
+            file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        file.close();
+        if (damage == 2) std::filesystem::resize_file(entry, 30);
+        CHECK(!cache.lookup(key, 3, read));
+        CHECK(!std::filesystem::exists(entry));
+    }
+    // Without variables cubes take no bytes, so any cube count is damage
+    stored[0].cover.clear();
+    cache.store(key, 0, stored);
+    CHECK(cache.lookup(key, 0, read) && read[0].cover.empty());
+    {
+        std::fstream file(entry, ios::in | ios::out | ios::binary);
+        file.seekp(18);
+        uint32_t cubes = 0xFFFFFFF0;
+        file.write(reinterpret_cast<const char*>(&cubes), sizeof(cubes));
+    }
+    CHECK(!cache.lookup(key, 0, read));
+
+    // A tiny limit keeps the directory from growing past it
+    options.cacheMaxBytes = 64;
+    mt19937 rng(17);
+    for (int it = 0; it < 20; it++) {
+        TestFunction f = randomFunction(rng, 6, 40, 10);
+        Minimizer(options).minimizeFunction(f.on, f.dc, 6);
+    }
+    size_t entries = 0;
+    for (const auto& e : std::filesystem::directory_iterator(directory)) entries += e.path().extension() == ".qc";
+    CHECK(entries < 20);
+    std::filesystem::remove_all(directory);
+}
+
+int main() {
+    struct Suite {
+        const char* name;
+        void (*run)();
+    } suites[] = {
+        {"cube", testCube},
+        {"combine", testCombine},
+        {"cube batch", testCubeBatch},
+        {"cube calculus", testCubeCalculus},
+        {"quine", testQuine},
+        {"espresso", testEspresso},
+        {"bdd", testBdd},
+        {"multi-output", testMultiOutput},
+        {"pla", testPLA},
+        {"writer", testWriter},
+        {"incremental", testIncremental},
+        {"cache", testCache},
+        {"minimizer", testMinimizer},
+        {"memory budget", testMemoryBudget},
+        {"cancel", testCancel},
+        {"batch", testBatch},
+    };
+
+    for (const Suite& suite : suites) {
+        int before = failures;
+        suite.run();
+        printf("%-14s %s\n", suite.name, failures == before ? "ok" : "FAILED");
+    }
+    printf("%d checks, %d failures\n", checks, failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}